@@ -0,0 +1,210 @@
+/*
+ Allocation accounting benchmark and zero allocation test.
+
+ Runs planning cycles on a Session as main.cpp does: parse the
+ 42["telemetry",{...}] message, Session::plan with the default
+ planner (tracking, behavior planning with prediction, candidates and
+ cost, the spline path, the checkpoint) and serializing the control
+ message, over 64 fixed telemetry frames on data/highway_map.csv.
+ Linked with the AllocAccounting hooks, so every allocation is counted
+ against the session and the stage.
+
+ Reports allocations and bytes per cycle by stage after a warmup, and
+ the session's high water heap use. Exits 1 if a checked stage
+ allocates in any steady state cycle: the stages already free of
+ allocations, or with --all every stage.
+
+ usage: ./alloc_bench [cycles] [--all]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <vector>
+#include "json.hpp"
+
+#include "Behavior_planning/spline.h"
+#include "Behavior_planning/path_smoother.h"
+#include "Behavior_planning/maneuver_templates.h"
+#include "Behavior_planning/alloc_accounting.h"
+#include "Behavior_planning/session.h"
+#include "Behavior_planning/telemetry.h"
+#include "helper_functions.h"
+#include "traffic.h"
+
+using json = nlohmann::json;
+
+// stages that must not allocate once the session is warm, add a stage
+// here when its allocations are gone
+static const Stage ZERO_ALLOC_STAGES[] = {Stage::TRACKING, Stage::PREDICTION, Stage::CANDIDATES, Stage::COST};
+
+// the frames of traffic.h as the simulator sends them
+static vector<string> make_messages(const vector<Telemetry> & frames)
+{
+
+  vector<string> messages;
+
+  for (const Telemetry & frame : frames) {
+
+    json data;
+
+    data["x"] = frame.car_x; data["y"] = frame.car_y; data["s"] = frame.car_s; data["d"] = frame.car_d;
+    data["yaw"] = frame.car_yaw; data["speed"] = frame.car_speed;
+    data["previous_path_x"] = frame.previous_path_x;
+    data["previous_path_y"] = frame.previous_path_y;
+    data["end_path_s"]      = frame.end_path_s;
+    data["end_path_d"]      = frame.end_path_d;
+    data["sensor_fusion"]   = frame.sensor_fusion;
+
+    messages.push_back("42[\"telemetry\"," + data.dump() + "]");
+  }
+  return messages;
+}
+
+int main(int argc, char * argv[])
+{
+
+  int  cycles = 500;
+  bool all    = false;
+
+  for (int i = 1; i < argc; i++) {
+
+    if (strcmp(argv[i], "--all") == 0) all = true;
+    else cycles = atoi(argv[i]);
+  }
+
+  if (!AllocAccounting::hooked) { fprintf(stderr, "built without the allocation hooks\n"); return 1; }
+
+  vector<double> maps_x, maps_y, maps_s, maps_dx, maps_dy;
+
+  load_Waypoints(maps_x, maps_y, maps_s, maps_dx, maps_dy);
+
+  if (maps_x.empty()) { fprintf(stderr, "no map, run from a directory next to data/\n"); return 1; }
+
+  auto xy = [&](double s, double d) { return getXY(s, d, maps_s, maps_x, maps_y); };
+
+  vector<string> messages = make_messages(make_frames(64, xy));
+
+  PlannerConfig config;
+
+  ConfigStore     config_store(config);
+  CheckpointStore checkpoints;
+
+  // the default planner of main.cpp
+  PlanningContext context(config_store, maps_s, maps_x, maps_y);
+
+  context.checkpoints = &checkpoints;
+
+  int ledger = AllocAccounting::open(0);
+
+  Session * session;
+  {
+    LedgerScope scope(ledger);
+    session = new Session(0, config);
+  }
+
+  session->token = CheckpointStore::new_token();
+
+  mute_planner_log();
+
+  int warmup = 50;
+
+  long steady_allocations[num_stages] = {}, steady_bytes[num_stages] = {};
+  int  allocating_cycles[num_stages]  = {};
+  long most_in_a_cycle[num_stages]    = {};
+
+  Telemetry telemetry;
+  string    msg;
+
+  for (int c = 0; c < warmup + cycles; c++) {
+
+    AllocStats before = AllocAccounting::stats(ledger);
+
+    {
+      LedgerScope scope(ledger);
+
+      {
+        StageScope stage(Stage::PARSE);
+
+        const string & message = messages[c % messages.size()];
+
+        json data = json::parse(message.substr(2))[1];
+
+        telemetry.car_x = data["x"]; telemetry.car_y = data["y"]; telemetry.car_s = data["s"];
+        telemetry.car_d = data["d"]; telemetry.car_yaw = data["yaw"]; telemetry.car_speed = data["speed"];
+        telemetry.previous_path_x = data["previous_path_x"].get<vector<double>>();
+        telemetry.previous_path_y = data["previous_path_y"].get<vector<double>>();
+        telemetry.end_path_s = data["end_path_s"];
+        telemetry.end_path_d = data["end_path_d"];
+        telemetry.sensor_fusion = data["sensor_fusion"].get<vector<vector<double>>>();
+      }
+
+      Control control = session->plan(telemetry, context);
+
+      {
+        StageScope stage(Stage::SERIALIZE);
+
+        json msgJson;
+        msgJson["next_x"] = control.next_x;
+        msgJson["next_y"] = control.next_y;
+
+        msg = "42[\"control\"," + msgJson.dump() + "]";
+      }
+    }
+
+    if (c < warmup) continue;
+
+    AllocStats after = AllocAccounting::stats(ledger);
+
+    for (int i = 0; i < num_stages; i++) {
+
+      long allocations = after.allocations[i] - before.allocations[i];
+
+      steady_allocations[i] += allocations;
+      steady_bytes[i]       += after.bytes[i] - before.bytes[i];
+
+      if (allocations > 0) allocating_cycles[i]++;
+
+      most_in_a_cycle[i] = max(most_in_a_cycle[i], allocations);
+    }
+  }
+
+  cout.clear();
+
+  AllocStats stats = AllocAccounting::stats(ledger);
+
+  printf("%d steady cycles after %d warmup, %zu telemetry frames\n", cycles, warmup, messages.size());
+  printf("%-12s %12s %12s %18s %10s  %s\n", "stage", "allocs/cycle", "bytes/cycle",
+         "allocating cycles", "most", "checked");
+
+  bool failed = false;
+
+  for (int i = 0; i < num_stages; i++) {
+
+    Stage stage = static_cast<Stage>(i);
+
+    bool checked = all;
+
+    for (Stage zero : ZERO_ALLOC_STAGES) checked |= zero == stage;
+
+    bool fails = checked && allocating_cycles[i] > 0;
+
+    failed |= fails;
+
+    printf("%-12s %12.2f %12.1f %11d/%-6d %10ld  %s\n", stage_name(stage),
+           (double) steady_allocations[i] / cycles, (double) steady_bytes[i] / cycles,
+           allocating_cycles[i], cycles, most_in_a_cycle[i],
+           !checked ? "" : fails ? "FAIL: allocates in steady state" : "ok");
+  }
+
+  printf("session heap: %ld bytes live, high water %ld bytes\n", stats.live, stats.high_water);
+
+  {
+    LedgerScope scope(ledger);
+    delete session;
+  }
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+/*
+ Session checkpoint benchmark.
+
+ Drives a session through 200 cycles of synthetic traffic (12 tracks),
+ then times Session::checkpoint and Session::restore into a fresh
+ session, and checks that the restored session takes the same next
+ decision as the original.
+
+ usage: ./checkpoint_bench [iterations]
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Behavior_planning/session.h"
+#include "traffic.h"
+
+static void cycle(Session & session, double t, double ego_s)
+{
+
+  session.road.ego_localization(ego_s);
+  session.road.add_vehicles_surrounding(ring_traffic(t), 0, .06);
+  session.road.behavior_planning();
+
+  session.ref_vel  = session.road.ego.v;
+  session.lane     = session.road.ego.lane;
+  session.sim_time = t;
+}
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+  PlannerConfig config;
+
+  mute_planner_log();
+
+  Session session(0, config);
+
+  double t = 0, ego_s = 0;
+
+  for (int k = 0; k < 200; k++, t += .06) {
+
+    cycle(session, t, ego_s);
+    ego_s += session.ref_vel / 2.24 * .06;
+  }
+
+  string blob;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; i++) session.checkpoint(blob);
+
+  chrono::duration<double, micro> checkpoint_us = chrono::steady_clock::now() - start;
+
+  Session restored(1, config);
+
+  start = chrono::steady_clock::now();
+
+  bool ok = true;
+
+  for (int i = 0; i < iterations; i++) ok &= restored.restore(blob);
+
+  chrono::duration<double, micro> restore_us = chrono::steady_clock::now() - start;
+
+  // the same next cycle on both
+  cycle(session, t, ego_s);
+  cycle(restored, t, ego_s);
+
+  bool same = session.road.ego.lane == restored.road.ego.lane
+           && session.road.ego.v == restored.road.ego.v
+           && session.road.ego.state == restored.road.ego.state;
+
+  string corrupt = blob.substr(0, blob.size() - 1);
+
+  cout.clear();
+
+  printf("checkpoint %zu bytes (%zu tracks): save %.2f us, restore %.2f us, %s\n",
+         blob.size(), session.road.tracks.size(), checkpoint_us.count() / iterations,
+         restore_us.count() / iterations, ok ? "restored" : "RESTORE FAILED");
+
+  printf("next decision %s: lane %d, %.1f mph, %s; truncated checkpoint %s\n",
+         same ? "matches" : "DIFFERS", restored.road.ego.lane, restored.road.ego.v,
+         state_name(restored.road.ego.state), restored.restore(corrupt) ? "ACCEPTED" : "rejected");
+
+  return ok && same ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+/*
+ Earliest deadline first planning benchmark.
+
+ Sessions send telemetry every 60 ms. Each plans paths of its own
+ length, 5 to 45 points, and the simulator drives the previous path
+ while the planner is busy, so prev_size of a message is what is left
+ of the last path sent to the session. Every job runs a FSM cycle on
+ the session's Road and then spins for the rest of a planning cost
+ drawn from 1 to 7 ms, so the offered load is set by the number of
+ sessions. Runs FIFO and EDF dispatch on the same arrivals and reports
+ deadline misses and slack quantiles.
+
+ usage: ./deadline_bench [sessions] [workers] [seconds]
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "Behavior_planning/deadline_scheduler.h"
+#include "Behavior_planning/session.h"
+#include "traffic.h"
+
+typedef DeadlineScheduler::clock clock_type;
+
+static double percentile(vector<double> & values, double q)
+{
+
+  if (values.empty()) return 0;
+
+  size_t k = min(values.size() - 1, (size_t) (q * values.size()));
+
+  nth_element(values.begin(), values.begin() + k, values.end());
+
+  return values[k];
+}
+
+int main(int argc, char * argv[])
+{
+
+  int    num_sessions = argc > 1 ? atoi(argv[1]) : 24;
+  int    num_workers  = argc > 2 ? atoi(argv[2]) : 1;
+  double seconds      = argc > 3 ? atof(argv[3]) : 3;
+
+  PlannerConfig config;
+
+  vector<vector<double>> sensor_fusion = block_traffic(config.lane_speeds.size(), 1000);
+
+  mute_planner_log();
+
+  // the same arrivals for both policies: per message session, time and cost
+  struct Arrival { int session; double at; double cost; };
+
+  vector<Arrival> arrivals;
+  vector<int>     path_points(num_sessions);
+
+  mt19937 rng(7);
+  uniform_real_distribution<double> cost(1, 7), phase(0, 60);
+
+  for (int i = 0; i < num_sessions; i++) {
+
+    path_points[i] = 5 + (i * 17) % 41;
+
+    for (double at = phase(rng); at < seconds * 1000; at += 60)
+      arrivals.push_back({i, at, cost(rng)});
+  }
+
+  sort(arrivals.begin(), arrivals.end(),
+       [](const Arrival & a, const Arrival & b) { return a.at < b.at; });
+
+  double offered = 0;
+  for (const Arrival & a : arrivals) offered += a.cost;
+
+  printf("%d sessions, %d worker(s), %zu messages, offered load %.2f\n",
+         num_sessions, num_workers, arrivals.size(), offered / (seconds * 1000 * num_workers));
+
+  for (Dispatch dispatch : {Dispatch::FIFO, Dispatch::EDF}) {
+
+    vector<shared_ptr<Session>> sessions;
+
+    // when the last path sent to the session runs out [us from start]
+    unique_ptr<atomic<long>[]> path_end(new atomic<long>[num_sessions]);
+
+    for (int i = 0; i < num_sessions; i++) {
+
+      sessions.push_back(make_shared<Session>(i, config));
+      sessions.back()->road.ego_localization(1000);
+
+      path_end[i] = path_points[i] * 20000;
+    }
+
+    DeadlineScheduler planner(num_workers);
+
+    planner.dispatch = dispatch;
+
+    mutex          slack_mutex;
+    vector<double> slack;
+
+    clock_type::time_point start = clock_type::now();
+
+    for (const Arrival & a : arrivals) {
+
+      this_thread::sleep_until(start + chrono::microseconds((long) (a.at * 1000)));
+
+      clock_type::time_point received = clock_type::now();
+
+      long now_us    = chrono::duration_cast<chrono::microseconds>(received - start).count();
+      int  prev_size = (int) max(0L, (path_end[a.session] - now_us) / 20000);
+
+      clock_type::time_point deadline = planner.deadline(received, prev_size);
+
+      Session * session = sessions[a.session].get();
+      double    ms      = a.cost;
+      int       id      = a.session;
+
+      planner.submit(id, prev_size, received, [&, session, ms, id, deadline]() {
+
+        session->road.add_vehicles_surrounding(sensor_fusion, 0, .06);
+        session->road.behavior_planning();
+
+        clock_type::time_point begin = clock_type::now();
+        while (chrono::duration<double, milli>(clock_type::now() - begin).count() < ms) {}
+
+        clock_type::time_point done = clock_type::now();
+
+        // the reply is a new path, driven from here
+        path_end[id] = chrono::duration_cast<chrono::microseconds>(done - start).count()
+                     + path_points[id] * 20000;
+
+        lock_guard<mutex> lock(slack_mutex);
+        slack.push_back(chrono::duration<double, milli>(deadline - done).count());
+      });
+    }
+
+    planner.drain();
+
+    DeadlineStats stats = planner.stats();
+
+    int worst_session = -1;
+    double worst_rate = 0;
+
+    for (auto & session : stats.sessions) {
+
+      double rate = (double) session.second.misses / max(1L, session.second.jobs);
+
+      if (rate >= worst_rate) { worst_rate = rate; worst_session = session.first; }
+    }
+
+    double p50 = percentile(slack, .5), p01 = percentile(slack, .01), p001 = percentile(slack, .001);
+
+    cout.clear();
+    printf("%-4s %5ld done, %4ld superseded, %4ld misses (%.1f%%), slack p50 %6.1f ms,"
+           " p1 %7.1f ms, p0.1 %7.1f ms, worst session %d (%d points, %.0f%% missed)\n",
+           dispatch == Dispatch::EDF ? "EDF" : "FIFO", stats.completed, stats.superseded,
+           stats.all.misses, 100.0 * stats.all.misses / max(1L, stats.completed),
+           p50, p01, p001, worst_session, worst_session >= 0 ? path_points[worst_session] : 0,
+           100 * worst_rate);
+    cout.setstate(ios::badbit);
+  }
+
+  cout.clear();
+
+  return 0;
+}
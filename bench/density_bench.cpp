@@ -0,0 +1,165 @@
+/*
+ Traffic density scaling benchmark.
+
+ Runs Road::add_vehicles_surrounding + Road::behavior_planning, one
+ cycle per 60 ms of simulated time, on synthetic sensor_fusion blocks
+ of 10, 50, 100, 500 and 1000 vehicles over 3 to 8 lanes, at two
+ spacings:
+
+   realistic   the vehicles spread evenly over the 6945 m loop, every
+               lane alike, as the simulator reports the whole road
+   worst       packed 6 m apart (bumper to bumper) centered on the ego,
+               so every vehicle is a neighbor
+
+ Writes one CSV row per (spacing, lanes, vehicles): time per cycle
+ (mean, p50, p99, max) and the share of the two calls, against a
+ latency budget, from which both scaling curves, time against vehicle
+ count and time against lane count, are plotted. The first setting
+ over budget per spacing goes to stderr.
+
+ usage: ./density_bench [cycles] [budget ms] > density.csv
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Behavior_planning/road.h"
+#include "traffic.h"
+
+enum class Spacing { REALISTIC, WORST };
+
+/*
+ Sensor fusion of every vehicle at time t, laid out by spacing.
+*/
+static void make_traffic(vector<vector<double>> & sensor_fusion, int vehicles, int lanes,
+                         Spacing spacing, double ego_s, double t)
+{
+
+  int per_lane = (vehicles + lanes - 1) / lanes;
+
+  double gap = spacing == Spacing::REALISTIC ? TRACK_S / per_lane : 6;
+
+  make_sensor_fusion(sensor_fusion, vehicles, lanes, [=](int id, int l, double v) {
+
+    int k = id / lanes;
+
+    // worst case keeps the pack around the ego, realistic moves with its speed
+    return spacing == Spacing::REALISTIC
+         ? k * gap + 11 * l + v * t
+         : ego_s + (k - per_lane / 2) * gap + 2 * l + (v - 19) * fmod(t, 1.0);
+  });
+}
+
+struct Timing {
+
+  double mean, p50, p99, max;    //[us] per cycle
+
+  double add_vehicles, behavior; //[us] mean per cycle
+};
+
+static Timing run(int vehicles, int lanes, Spacing spacing, int cycles)
+{
+
+  PlannerConfig config;
+
+  config.lane_speeds.assign(lanes, 49);
+  config.goal = {(int) TRACK_S, lanes / 2};
+
+  Road road(config.speed_limit, config.lane_speeds);
+
+  road.add_ego(lanes / 2, 0, 20, config.ego_config());
+  road.configure(config);
+
+  vector<vector<double>> sensor_fusion;
+  vector<double> cycle_us;
+
+  double ego_s = 1000, t = 0, add_us = 0, behavior_us = 0;
+
+  int warmup = max(5, cycles / 10);
+
+  for (int c = 0; c < warmup + cycles; c++, t += .06) {
+
+    make_traffic(sensor_fusion, vehicles, lanes, spacing, ego_s, t);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    road.ego_localization(ego_s);
+    road.add_vehicles_surrounding(sensor_fusion, 45, .06);
+
+    chrono::steady_clock::time_point added = chrono::steady_clock::now();
+
+    road.behavior_planning();
+
+    chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+
+    ego_s = fmod(ego_s + max(road.ego.v, 5.f) / 2.24 * .06, TRACK_S);
+
+    if (c < warmup) continue;
+
+    add_us      += chrono::duration<double, micro>(added - start).count();
+    behavior_us += chrono::duration<double, micro>(stop - added).count();
+
+    cycle_us.push_back(chrono::duration<double, micro>(stop - start).count());
+  }
+
+  sort(cycle_us.begin(), cycle_us.end());
+
+  Timing timing;
+
+  timing.mean         = (add_us + behavior_us) / cycles;
+  timing.p50          = cycle_us[cycle_us.size() / 2];
+  timing.p99          = cycle_us[min(cycle_us.size() - 1, cycle_us.size() * 99 / 100)];
+  timing.max          = cycle_us.back();
+  timing.add_vehicles = add_us / cycles;
+  timing.behavior     = behavior_us / cycles;
+
+  return timing;
+}
+
+int main(int argc, char * argv[])
+{
+
+  int    cycles    = argc > 1 ? atoi(argv[1]) : 200;
+  double budget_ms = argc > 2 ? atof(argv[2]) : 20;   // one path point
+
+  const int vehicle_counts[] = {10, 50, 100, 500, 1000};
+
+  mute_planner_log();
+
+  printf("spacing,lanes,vehicles,cycles,mean_us,p50_us,p99_us,max_us,add_vehicles_us,behavior_us,budget_ms,over_budget\n");
+
+  for (Spacing spacing : {Spacing::REALISTIC, Spacing::WORST}) {
+
+    const char * name = spacing == Spacing::REALISTIC ? "realistic" : "worst";
+
+    bool reported = false;
+
+    for (int lanes = 3; lanes <= 8; lanes++) {
+
+      for (int vehicles : vehicle_counts) {
+
+        Timing timing = run(vehicles, lanes, spacing, cycles);
+
+        bool over = timing.p99 > budget_ms * 1000;
+
+        printf("%s,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%d\n", name, lanes, vehicles, cycles,
+               timing.mean, timing.p50, timing.p99, timing.max, timing.add_vehicles, timing.behavior,
+               budget_ms, over ? 1 : 0);
+
+        fflush(stdout);
+
+        if (over && !reported) {
+
+          fprintf(stderr, "%s spacing: p99 %.2f ms over the %.1f ms budget from %d vehicles on %d lanes\n",
+                  name, timing.p99 / 1000, budget_ms, vehicles, lanes);
+          reported = true;
+        }
+      }
+    }
+
+    if (!reported) fprintf(stderr, "%s spacing: within the %.1f ms budget up to 1000 vehicles on 8 lanes\n", name, budget_ms);
+  }
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+/*
+ Path feasibility checker benchmark.
+
+ Checks the 50 point paths Waypoints emits while driving the track at
+ 49 mph, changing lanes every 500 m, then the first second of every sampled Frenet candidate (s and d
+ taken as plane coordinates) one path at a time and as a time major
+ batch. Reads ../data/highway_map.csv, run it from the build directory.
+
+ usage: ./feasibility_bench [iterations]
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Behavior_planning/spline.h"
+#include "Behavior_planning/feasibility.h"
+#include "Behavior_planning/frenet_sampler.h"
+#include "Behavior_planning/maneuver_templates.h"
+#include "Behavior_planning/path_smoother.h"
+#include "Behavior_planning/prediction.h"
+#include "helper_functions.h"
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 100;
+
+  vector<double> map_x, map_y, map_s, map_dx, map_dy;
+
+  load_Waypoints(map_x, map_y, map_s, map_dx, map_dy);
+
+  if (map_s.empty()) {
+
+    printf("no map, run from the build directory\n");
+    return 1;
+  }
+
+  FeasibilityChecker checker;
+
+  // drive the track at 49 mph, 3 points consumed per cycle, changing
+  // to the right lane and back every 500 m
+  double ref_vel = 49;  //[mph]
+  double step    = 0.02 * ref_vel / 2.24;
+
+  vector<double> behind = getXY(10 - step, 6, map_s, map_x, map_y);
+  vector<double> start  = getXY(10, 6, map_s, map_x, map_y);
+
+  vector<double> path_x = {behind[0], start[0]}, path_y = {behind[1], start[1]};
+
+  double end_s = 10, elapsed_ms = 0, speed = 0, lon_accel = 0, lat_accel = 0, jerk = 0;
+  int    cycles = 0, infeasible = 0;
+
+  while (end_s < map_s.back() - 200) {
+
+    int lane = (int) (end_s / 500) % 2 ? 2 : 1;
+
+    Waypoints wp(path_x.size(), lane, path_x.back(), path_y.back(), 0, end_s,
+                 map_s, map_x, map_y, path_x, path_y);
+
+    wp.spaced_waypoints_generator();
+    wp.detailed_waypoints_generator(ref_vel);
+
+    for (int i = 0; i < iterations; i++) {
+
+      checker.check(wp.next_x_vals, wp.next_y_vals);
+      elapsed_ms += checker.stats.elapsed_ms;
+    }
+
+    const FeasibilityStats & stats = checker.stats;
+
+    speed       = max(speed, stats.speed);
+    lon_accel   = max(lon_accel, stats.lon_accel);
+    lat_accel   = max(lat_accel, stats.lat_accel);
+    jerk        = max(jerk, stats.jerk);
+    infeasible += stats.first >= 0;
+    cycles++;
+
+    path_x.assign(wp.next_x_vals.begin() + 3, wp.next_x_vals.end());
+    path_y.assign(wp.next_y_vals.begin() + 3, wp.next_y_vals.end());
+
+    int    n     = path_x.size();
+    double theta = atan2(path_y[n-1] - path_y[n-2], path_x[n-1] - path_x[n-2]);
+
+    end_s = getFrenet(path_x[n-1], path_y[n-1], theta, map_x, map_y)[0];
+  }
+
+  printf("%d emitted paths %6.2f us/path, %d infeasible, peaks %.2f m/s,"
+         " %.2f/%.2f m/s^2 lon/lat, %.2f m/s^3\n",
+         cycles, 1000 * elapsed_ms / cycles / iterations, infeasible, speed, lon_accel, lat_accel, jerk);
+
+  // candidates of the Frenet sampler, time major
+  Prediction prediction(5.0, 0.1);
+
+  for (int i = 0; i < 12; i++) {
+
+    int lane = i % 3;
+
+    prediction.add(i, 980.0f + 15.0f * i, 2.0f + 4.0f * lane, 12.0f + lane * 3, 0, 0);
+  }
+
+  prediction.rollout();
+
+  FrenetSampler sampler;
+
+  sampler.plan(1000.0f, 20.0f, 0, 6.0f, 1, prediction);
+
+  int paths  = sampler.size;
+  int points = 50;
+
+  vector<double> x(paths * points), y(paths * points);
+
+  for (int t = 0; t < points; t++) {
+
+    for (int p = 0; p < paths; p++) {
+
+      x[t * paths + p] = sampler.s_at(p, t * checker.dt) - 1000.0f;
+      y[t * paths + p] = sampler.d_at(p, t * checker.dt);
+    }
+  }
+
+  vector<int> first(paths);
+
+  double batch_ms = 0;
+
+  for (int i = 0; i < iterations; i++) {
+
+    checker.check_batch(&x[0], &y[0], paths, points, &first[0]);
+    batch_ms += checker.stats.elapsed_ms;
+  }
+
+  int feasible = checker.stats.feasible;
+
+  // the same candidates one path at a time
+  vector<double> candidate_x(points), candidate_y(points);
+
+  double single_ms = 0;
+  int    agree     = 0;
+
+  for (int i = 0; i < iterations; i++) {
+
+    for (int p = 0; p < paths; p++) {
+
+      for (int t = 0; t < points; t++) {
+
+        candidate_x[t] = x[t * paths + p];
+        candidate_y[t] = y[t * paths + p];
+      }
+
+      int violation = checker.check(candidate_x, candidate_y);
+
+      single_ms += checker.stats.elapsed_ms;
+      agree     += i == 0 && violation == first[p];
+    }
+  }
+
+  printf("%d candidates x %d points: batch %.2f ns/point, one at a time %.2f ns/point,"
+         " %d feasible, %d of %d agree\n",
+         paths, points, 1e6 * batch_ms / iterations / (paths * points),
+         1e6 * single_ms / iterations / (paths * points), feasible, agree, paths);
+
+  return 0;
+}
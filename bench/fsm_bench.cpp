@@ -0,0 +1,138 @@
+/*
+ Behavior FSM benchmark.
+
+ Counts heap allocations and time per call for the pieces of one
+ behavior cycle: copying a Vehicle, successor states, trajectory
+ generation, choose_next_state, the sensor fusion update and the whole
+ Road::behavior_planning, next to the lattice alternative.
+
+ usage: ./fsm_bench [iterations]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "Behavior_planning/road.h"
+#include "Behavior_planning/vehicle.h"
+#include "traffic.h"
+
+static long allocations = 0;
+
+void * operator new(size_t size) {
+
+  allocations++;
+  void * p = malloc(size);
+  if (!p) throw bad_alloc();
+  return p;
+}
+
+void operator delete(void * p) noexcept { free(p); }
+
+void operator delete(void * p, size_t) noexcept { free(p); }
+
+template <typename F>
+static void run(const char * name, int iterations, F f)
+{
+
+  long   start_allocations = allocations;
+  auto   start = chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; i++) f();
+
+  auto   stop = chrono::steady_clock::now();
+  double ns   = chrono::duration<double, nano>(stop - start).count();
+
+  printf("%-28s %10.1f ns/op %8.2f allocs/op\n", name,
+         ns / iterations, (double) (allocations - start_allocations) / iterations);
+}
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+
+  int SPEED_LIMIT         = 49;
+  vector<int> LANE_SPEEDS = {49, 49, 49};
+  int MAX_ACCEL           = 10;
+  vector<int> GOAL        = {6945, 1};
+
+  int num_lanes          = LANE_SPEEDS.size();
+  vector<int> ego_config = {SPEED_LIMIT, num_lanes, GOAL[0],
+                            GOAL[1], MAX_ACCEL, SPEED_LIMIT};
+
+  Road road = Road(SPEED_LIMIT, LANE_SPEEDS);
+  road.add_ego(1, 0, 20, ego_config);
+  road.ego_localization(1000);
+  vector<vector<double>> sensor_fusion = block_traffic(num_lanes, 1000);
+
+  mute_planner_log();
+
+  road.add_vehicles_surrounding(sensor_fusion, 0);
+  road.behavior_planning();
+
+  const map<int, vector<Vehicle>> & predictions = road.predictions;
+
+  Vehicle ego = road.get_ego();
+
+  Vehicle copy;
+  volatile int checksum = 0;
+
+  printf("iterations: %d, vehicles: %d\n", iterations, (int) predictions.size());
+
+  run("Vehicle copy", iterations, [&]() {
+    copy = predictions.begin()->second[0];
+    checksum += copy.s;
+  });
+
+  run("successor_states", iterations, [&]() {
+    checksum += ego.successor_states().size();
+  });
+
+  run("generate_trajectory KL", iterations, [&]() {
+    checksum += ego.generate_trajectory(State::KL, predictions).size();
+  });
+
+  run("generate_trajectory PLCL", iterations, [&]() {
+    checksum += ego.generate_trajectory(State::PLCL, predictions).size();
+  });
+
+  run("generate_trajectory LCR", iterations, [&]() {
+    checksum += ego.generate_trajectory(State::LCR, predictions).size();
+  });
+
+  run("choose_next_state", iterations, [&]() {
+    checksum += ego.choose_next_state(predictions).size();
+  });
+
+  run("Road::add_vehicles_surr.", iterations, [&]() {
+    road.add_vehicles_surrounding(sensor_fusion, 0, 0.02);
+  });
+
+  run("Road::behavior_planning", iterations, [&]() {
+    road.ego_localization(1000);
+    road.behavior_planning();
+  });
+
+  // a little further back, where the gap ahead leaves room to plan
+  run("Road::lattice_planning", iterations / 10, [&]() {
+    road.ego_localization(985);
+    road.ego.lane = 1;
+    road.lattice_planning(44.8);
+  });
+
+  cout.clear();
+
+  printf("last cycle: pruned %d/%d candidates, evaluated %d/%d cost terms\n",
+         road.cost_stats.pruned, road.cost_stats.candidates,
+         road.cost_stats.terms_evaluated, road.cost_stats.terms_total);
+
+  printf("last cycle: %ld lane feature lookups served by %ld scan(s) of %ld vehicles\n",
+         road.lane_features.lookups, road.lane_features.scans, road.lane_features.vehicles_per_scan);
+
+  printf("lattice: %d primitives, last plan %d expansions, %d pushes, %d footprint checks, %s\n",
+         (int) road.lattice.primitives.size(), road.lattice.stats.expansions,
+         road.lattice.stats.pushes, road.lattice.stats.cell_checks,
+         road.lattice.stats.found ? "horizon reached" : "partial path");
+
+  return 0;
+}
@@ -0,0 +1,805 @@
+/*
+ Load generator for the planner's WebSocket server.
+
+ Opens N WebSocket clients to the planner and sends each one's
+ telemetry as the simulator does, 42["telemetry",{...}] at a fixed
+ rate. Synthetic clients drive along data/highway_map.csv on the paths
+ the planner sends back: 50 points a second are driven, the rest go
+ back as previous_path, so prev_size and the planning deadlines look
+ like the simulator's. Each has 12 vehicles of traffic in 3 lanes.
+ --replay sends recorded telemetry lines instead, open loop.
+
+ Every message carries a "seq" the planner echoes in its control
+ reply. Reports the request to control latency distribution,
+ throughput and drops: requests superseded by newer telemetry of the
+ same session, unanswered after --timeout, or not sent because the
+ socket backed up. With --pid, the planner's CPU time per session from
+ /proc. --sweep grows N (doubling, or by --step) until the p99 latency
+ exceeds --p99 and reports the last N within it.
+
+ usage: ./load_generator [--host 127.0.0.1] [--port 4567] [--clients 1]
+                         [--rate 10] [--duration 10] [--warmup 2]
+                         [--timeout 1000] [--pid PID] [--replay FILE]
+                         [--map ../data/highway_map.csv]
+                         [--sweep] [--p99 50] [--step 0] [--max 1024]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "json.hpp"
+#include "traffic.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+typedef chrono::steady_clock clock_type;
+
+struct Options {
+
+  string host     = "127.0.0.1";
+
+  string port     = "4567";
+
+  int    clients  = 1;
+
+  double rate     = 10;      //[Hz] telemetry messages per client
+
+  double duration = 10;      //[s] measured per step
+
+  double warmup   = 2;       //[s] before each step is measured
+
+  double timeout  = 1000;    //[ms] unanswered requests count as dropped
+
+  int    pid      = 0;       // planner process, 0 for no CPU figures
+
+  string replay;             // recorded telemetry, one message per line
+
+  string map_file = "../data/highway_map.csv";
+
+  bool   sweep    = false;
+
+  double p99      = 50;      //[ms] sweep target
+
+  int    step     = 0;       // clients added per sweep step, 0 doubles
+
+  int    max      = 1024;    // clients at most
+};
+
+/*
+ Waypoints of the track, x y s dx dy per line, with the conversions
+ between Frenet and map coordinates the synthetic drive needs.
+*/
+struct Track {
+
+  vector<double> x, y, s;
+
+  double max_s = 6945.554;
+
+  bool load(const string & file) {
+
+    ifstream in(file.c_str());
+    double wx, wy, ws, dx, dy;
+
+    while (in >> wx >> wy >> ws >> dx >> dy) { x.push_back(wx); y.push_back(wy); s.push_back(ws); }
+
+    return x.size() > 1;
+  }
+
+  int segment(double at) const {
+
+    return max(0, (int) (upper_bound(s.begin(), s.end(), at) - s.begin()) - 1);
+  }
+
+  // d grows to the right of the driving direction
+  void to_xy(double at, double d, double & px, double & py, double & heading) const {
+
+    at = fmod(fmod(at, max_s) + max_s, max_s);
+
+    int    i = segment(at);
+    int    j = (i + 1) % x.size();
+    double length = (j == 0 ? max_s : s[j]) - s[i];
+    double t = (at - s[i]) / length;
+
+    heading = atan2(y[j] - y[i], x[j] - x[i]);
+
+    px = x[i] + t * (x[j] - x[i]) + d * sin(heading);
+    py = y[i] + t * (y[j] - y[i]) - d * cos(heading);
+  }
+
+  void to_frenet(double px, double py, double & at, double & d) const {
+
+    int closest = 0;
+    double best = 1e18;
+
+    for (int i = 0; i < (int) x.size(); i++) {
+
+      double dist = (px - x[i]) * (px - x[i]) + (py - y[i]) * (py - y[i]);
+
+      if (dist < best) { best = dist; closest = i; }
+    }
+
+    int n = x.size();
+
+    for (int i : {closest, (closest + n - 1) % n}) {
+
+      int    j  = (i + 1) % n;
+      double ux = x[j] - x[i], uy = y[j] - y[i];
+      double length = sqrt(ux * ux + uy * uy);
+      double t  = ((px - x[i]) * ux + (py - y[i]) * uy) / length;
+
+      if (t < 0 && i == closest) continue;
+
+      at = fmod(s[i] + t, max_s);
+      d  = ((px - x[i]) * uy - (py - y[i]) * ux) / length;
+      return;
+    }
+  }
+};
+
+/*
+ Per step figures of one client or of all.
+*/
+struct LoadStats {
+
+  long sent       = 0;
+
+  long answered   = 0;
+
+  long superseded = 0;   // a reply to a newer request came first
+
+  long timed_out  = 0;
+
+  long backed_up  = 0;   // socket buffer full, never sent
+
+  vector<double> latency;   //[ms]
+
+  long dropped() const { return superseded + timed_out + backed_up; }
+};
+
+static double quantile(vector<double> & values, double q) {
+
+  if (values.empty()) return 0;
+
+  size_t k = min(values.size() - 1, (size_t) (q * values.size()));
+
+  nth_element(values.begin(), values.begin() + k, values.end());
+
+  return values[k];
+}
+
+struct Client {
+
+  int    fd = -1;
+
+  bool   open = false;
+
+  string in, out;        // bytes not framed yet, not sent yet
+
+  uint64_t seq = 0;      // of the next request
+
+  uint64_t applied = 0;  // newest reply driven on, seq + 1
+
+  map<uint64_t, pair<clock_type::time_point, bool>> pending;   // sent at, measured
+
+  clock_type::time_point next_send, last_send, start;
+
+  // synthetic drive: the path not driven yet and the car on it
+  deque<pair<double, double>> path;
+
+  double due = 0;        // points to drive, fractional
+
+  double x = 0, y = 0, s = 0, d = 6, yaw = 0, speed = 0;
+
+  double s0 = 0;         // where it started, the traffic is placed from it
+
+  size_t line = 0;       // next replayed message
+
+  LoadStats stats;
+};
+
+static bool send_all(int fd, const string & data) {
+
+  for (size_t sent = 0; sent < data.size(); ) {
+
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+// blocking connect and upgrade, then the socket is polled
+static bool connect_client(Client & client, const Options & options) {
+
+  addrinfo hints, * address;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family   = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  if (getaddrinfo(options.host.c_str(), options.port.c_str(), &hints, &address) != 0) return false;
+
+  client.fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+
+  bool connected = client.fd >= 0 && connect(client.fd, address->ai_addr, address->ai_addrlen) == 0;
+
+  freeaddrinfo(address);
+
+  if (!connected) return false;
+
+  int one = 1;
+  setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  string request = "GET / HTTP/1.1\r\nHost: " + options.host + ":" + options.port + "\r\n"
+                   "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                   "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+  if (!send_all(client.fd, request)) return false;
+
+  char buffer[4096];
+  size_t end;
+
+  while ((end = client.in.find("\r\n\r\n")) == string::npos) {
+
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+
+    if (n <= 0) return false;
+    client.in.append(buffer, n);
+  }
+
+  if (client.in.find(" 101 ") == string::npos || client.in.find(" 101 ") > end) return false;
+
+  client.in.erase(0, end + 4);
+  client.open = true;
+
+  return true;
+}
+
+// client frames are masked, RFC 6455 5.3
+static void frame(string & out, const string & payload, int opcode) {
+
+  unsigned char mask[4];
+
+  for (int i = 0; i < 4; i++) mask[i] = rand() & 255;
+
+  out += (char) (0x80 | opcode);
+
+  size_t size = payload.size();
+
+  if (size < 126) {
+
+    out += (char) (0x80 | size);
+
+  } else if (size < 65536) {
+
+    out += (char) (0x80 | 126);
+    out += (char) (size >> 8);
+    out += (char) (size & 255);
+
+  } else {
+
+    out += (char) (0x80 | 127);
+
+    for (int shift = 56; shift >= 0; shift -= 8) out += (char) ((size >> shift) & 255);
+  }
+
+  out.append((const char *) mask, 4);
+
+  for (size_t i = 0; i < size; i++) out += (char) (payload[i] ^ mask[i & 3]);
+}
+
+static void flush(Client & client) {
+
+  while (!client.out.empty()) {
+
+    ssize_t n = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+
+    if (n <= 0) {
+
+      if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) client.open = false;
+      return;
+    }
+    client.out.erase(0, n);
+  }
+}
+
+/*
+ Drives the points due since the last message and builds the next
+ telemetry from where the car ended up.
+*/
+static string synthetic_telemetry(Client & client, const Track & track, clock_type::time_point now) {
+
+  double elapsed = chrono::duration<double>(now - client.last_send).count();
+
+  client.due += elapsed * 50;
+
+  int driven = min((int) client.due, (int) client.path.size());
+
+  client.due -= (int) client.due;
+
+  double last_x = client.x, last_y = client.y;
+
+  for (int i = 0; i < driven; i++) {
+
+    last_x = client.x; last_y = client.y;
+
+    client.x = client.path.front().first;
+    client.y = client.path.front().second;
+    client.path.pop_front();
+  }
+
+  if (driven > 0 && (client.x != last_x || client.y != last_y)) {
+
+    client.speed = hypot(client.x - last_x, client.y - last_y) / .02 * 2.24;
+    client.yaw   = atan2(client.y - last_y, client.x - last_x) * 180 / M_PI;
+
+  } else if (driven > 0) {
+
+    client.speed = 0;
+  }
+
+  track.to_frenet(client.x, client.y, client.s, client.d);
+
+  json data;
+
+  data["x"]     = client.x;
+  data["y"]     = client.y;
+  data["s"]     = client.s;
+  data["d"]     = client.d;
+  data["yaw"]   = client.yaw;
+  data["speed"] = client.speed;
+
+  vector<double> previous_x, previous_y;
+
+  for (const pair<double, double> & point : client.path) {
+
+    previous_x.push_back(point.first);
+    previous_y.push_back(point.second);
+  }
+
+  double end_s = 0, end_d = 0;
+
+  if (!client.path.empty()) track.to_frenet(client.path.back().first, client.path.back().second, end_s, end_d);
+
+  data["previous_path_x"] = previous_x;
+  data["previous_path_y"] = previous_y;
+  data["end_path_s"]      = end_s;
+  data["end_path_d"]      = end_d;
+
+  // traffic at 14 to 24 m/s in 3 lanes, starting ahead of the client
+  double t = chrono::duration<double>(now - client.start).count();
+
+  auto xy = [&track](double s, double d) {
+
+    double x, y, heading;
+
+    track.to_xy(s, d, x, y, heading);
+    return vector<double>{x, y};
+  };
+
+  data["sensor_fusion"] = ring_traffic(t, client.s0 + 40, xy);
+  data["seq"]           = client.seq;
+
+  return "42[\"telemetry\"," + data.dump() + "]";
+}
+
+// the recorded message with a seq put first in its data object
+static string replayed_telemetry(Client & client, const vector<string> & lines) {
+
+  const string & line = lines[client.line++ % lines.size()];
+
+  size_t brace = line.find('{');
+
+  return line.substr(0, brace + 1) + "\"seq\":" + to_string(client.seq) + ","  + line.substr(brace + 1);
+}
+
+static void receive(Client & client, const Options & options, clock_type::time_point now) {
+
+  char buffer[65536];
+
+  while (true) {
+
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) { client.open = false; break; }
+    if (n < 0) break;
+
+    client.in.append(buffer, n);
+  }
+
+  size_t at = 0;
+
+  while (client.in.size() - at >= 2) {
+
+    const unsigned char * header = (const unsigned char *) client.in.data() + at;
+
+    int      opcode = header[0] & 15;
+    uint64_t size   = header[1] & 127;
+    size_t   length = 2;
+
+    if (size == 126) {
+
+      if (client.in.size() - at < 4) break;
+      size = (header[2] << 8) | header[3];
+      length = 4;
+
+    } else if (size == 127) {
+
+      if (client.in.size() - at < 10) break;
+      size = 0;
+      for (int i = 0; i < 8; i++) size = (size << 8) | header[2 + i];
+      length = 10;
+    }
+
+    if (client.in.size() - at < length + size) break;
+
+    string payload = client.in.substr(at + length, size);
+
+    at += length + size;
+
+    if (opcode == 8) { client.open = false; break; }
+
+    if (opcode == 9) { frame(client.out, payload, 10); continue; }
+
+    if (opcode != 1 || payload.compare(0, 12, "42[\"control\"") != 0) continue;
+
+    json data = json::parse(payload.substr(2))[1];
+
+    if (!data.count("seq")) continue;
+
+    uint64_t seq = data["seq"];
+
+    auto request = client.pending.find(seq);
+
+    if (request == client.pending.end()) continue;
+
+    // a session's replies come in order, the older requests were superseded
+    for (auto it = client.pending.begin(); it != request; it = client.pending.erase(it))
+      if (it->second.second) client.stats.superseded++;
+
+    if (request->second.second) {
+
+      client.stats.answered++;
+      client.stats.latency.push_back(chrono::duration<double, milli>(now - request->second.first).count());
+    }
+
+    client.pending.erase(request);
+
+    if (options.replay.empty() && seq + 1 > client.applied) {
+
+      vector<double> next_x = data["next_x"], next_y = data["next_y"];
+
+      client.path.clear();
+
+      for (size_t i = 0; i < next_x.size() && i < next_y.size(); i++) client.path.push_back({next_x[i], next_y[i]});
+
+      client.applied = seq + 1;
+    }
+  }
+
+  client.in.erase(0, at);
+}
+
+static void send_telemetry(Client & client, const Options & options, const Track & track,
+                           const vector<string> & lines, clock_type::time_point now, bool measured) {
+
+  string message = options.replay.empty() ? synthetic_telemetry(client, track, now)
+                                          : replayed_telemetry(client, lines);
+
+  client.last_send = now;
+
+  if (measured) client.stats.sent++;
+
+  // a planner not keeping up with the socket, not queued further
+  if (client.out.size() > (1 << 20)) {
+
+    if (measured) client.stats.backed_up++;
+    client.seq++;
+    return;
+  }
+
+  frame(client.out, message, 1);
+
+  client.pending[client.seq++] = {now, measured};
+
+  flush(client);
+}
+
+// user + system time of a process, [s]
+static double process_cpu(int pid) {
+
+  if (pid == 0) {
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+  }
+
+  ifstream in(("/proc/" + to_string(pid) + "/stat").c_str());
+  string stat;
+  getline(in, stat);
+
+  // fields after the parenthesized command name, utime and stime are 14 and 15
+  size_t close = stat.rfind(')');
+
+  if (close == string::npos) return 0;
+
+  vector<string> fields;
+  string field;
+
+  for (size_t i = close + 2; i <= stat.size(); i++) {
+
+    if (i == stat.size() || stat[i] == ' ') { fields.push_back(field); field.clear(); }
+    else field += stat[i];
+  }
+
+  if (fields.size() < 13) return 0;
+
+  return (atof(fields[11].c_str()) + atof(fields[12].c_str())) / sysconf(_SC_CLK_TCK);
+}
+
+/*
+ One load step: warmup, the measured window, then the timeout long
+ drain during which the load goes on but is not measured.
+*/
+static LoadStats run_step(vector<unique_ptr<Client>> & clients, const Options & options, const Track & track,
+                          const vector<string> & lines, double & planner_cpu, double & generator_cpu,
+                          double & worst_session_p99) {
+
+  double period = 1 / options.rate;
+
+  for (unique_ptr<Client> & client : clients) { client->stats = LoadStats(); client->pending.clear(); }
+
+  clock_type::time_point begin   = clock_type::now();
+  clock_type::time_point measure = begin + chrono::microseconds((long) (options.warmup * 1e6));
+  clock_type::time_point end     = measure + chrono::microseconds((long) (options.duration * 1e6));
+  clock_type::time_point drained = end + chrono::microseconds((long) (options.timeout * 1e3));
+
+  double planner_start = 0, generator_start = 0;
+  bool   measuring = false;
+
+  vector<pollfd> fds(clients.size());
+
+  for (clock_type::time_point now = begin; now < drained; now = clock_type::now()) {
+
+    if (!measuring && now >= measure) {
+
+      measuring       = true;
+      planner_start   = options.pid ? process_cpu(options.pid) : 0;
+      generator_start = process_cpu(0);
+    }
+
+    if (measuring && now >= end && planner_start >= 0) {
+
+      planner_cpu     = options.pid ? process_cpu(options.pid) - planner_start : 0;
+      generator_cpu   = process_cpu(0) - generator_start;
+      planner_start   = -1;
+    }
+
+    clock_type::time_point next = drained;
+
+    for (size_t i = 0; i < clients.size(); i++) {
+
+      Client & client = *clients[i];
+
+      if (client.open && now >= client.next_send) {
+
+        send_telemetry(client, options, track, lines, now, now >= measure && now < end);
+
+        client.next_send += chrono::microseconds((long) (period * 1e6));
+
+        // behind by more than a period, start over rather than burst
+        if (client.next_send < now) client.next_send = now + chrono::microseconds((long) (period * 1e6));
+      }
+
+      next = min(next, client.next_send);
+
+      fds[i].fd      = client.open ? client.fd : -1;
+      fds[i].events  = POLLIN | (client.out.empty() ? 0 : POLLOUT);
+      fds[i].revents = 0;
+    }
+
+    int wait_ms = max(0, (int) chrono::duration_cast<chrono::milliseconds>(next - clock_type::now()).count());
+
+    if (poll(fds.data(), fds.size(), wait_ms) <= 0) continue;
+
+    now = clock_type::now();
+
+    for (size_t i = 0; i < clients.size(); i++) {
+
+      if (fds[i].revents & POLLOUT) flush(*clients[i]);
+
+      if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) receive(*clients[i], options, now);
+    }
+  }
+
+  LoadStats total;
+
+  worst_session_p99 = 0;
+
+  for (unique_ptr<Client> & client : clients) {
+
+    LoadStats & stats = client->stats;
+
+    for (auto & request : client->pending) if (request.second.second) stats.timed_out++;
+
+    total.sent       += stats.sent;
+    total.answered   += stats.answered;
+    total.superseded += stats.superseded;
+    total.timed_out  += stats.timed_out;
+    total.backed_up  += stats.backed_up;
+
+    total.latency.insert(total.latency.end(), stats.latency.begin(), stats.latency.end());
+
+    worst_session_p99 = max(worst_session_p99, quantile(stats.latency, .99));
+  }
+
+  return total;
+}
+
+static bool add_clients(vector<unique_ptr<Client>> & clients, int count, const Options & options, const Track & track) {
+
+  while ((int) clients.size() < count) {
+
+    unique_ptr<Client> client(new Client());
+
+    if (!connect_client(*client, options)) {
+
+      fprintf(stderr, "client %zu could not connect to %s:%s\n", clients.size(), options.host.c_str(), options.port.c_str());
+      return false;
+    }
+
+    int i = clients.size();
+
+    // spread over the track, each client its own stretch of road
+    double heading;
+
+    client->s0   = fmod(150 + 397.0 * i, track.max_s);
+    client->line = i * 7;
+
+    track.to_xy(client->s0, client->d, client->x, client->y, heading);
+
+    client->yaw       = heading * 180 / M_PI;
+    client->start     = clock_type::now();
+    client->last_send = client->start;
+
+    // staggered over a period, not all at once
+    client->next_send = client->start + chrono::microseconds((long) (1e6 / options.rate * i / max(1, count)));
+
+    clients.push_back(move(client));
+  }
+  return true;
+}
+
+int main(int argc, char * argv[])
+{
+
+  Options options;
+
+  for (int i = 1; i < argc; i++) {
+
+    string option = argv[i];
+    const char * value = i + 1 < argc ? argv[i + 1] : "";
+
+    if      (option == "--host")     { options.host     = value; i++; }
+    else if (option == "--port")     { options.port     = value; i++; }
+    else if (option == "--clients")  { options.clients  = atoi(value); i++; }
+    else if (option == "--rate")     { options.rate     = atof(value); i++; }
+    else if (option == "--duration") { options.duration = atof(value); i++; }
+    else if (option == "--warmup")   { options.warmup   = atof(value); i++; }
+    else if (option == "--timeout")  { options.timeout  = atof(value); i++; }
+    else if (option == "--pid")      { options.pid      = atoi(value); i++; }
+    else if (option == "--replay")   { options.replay   = value; i++; }
+    else if (option == "--map")      { options.map_file = value; i++; }
+    else if (option == "--p99")      { options.p99      = atof(value); i++; }
+    else if (option == "--step")     { options.step     = atoi(value); i++; }
+    else if (option == "--max")      { options.max      = atoi(value); i++; }
+    else if (option == "--sweep")    { options.sweep    = true; }
+    else { fprintf(stderr, "unknown option %s\n", option.c_str()); return 1; }
+  }
+
+  if (options.clients < 1 || options.rate <= 0 || options.duration <= 0) {
+
+    fprintf(stderr, "--clients, --rate and --duration must be positive\n");
+    return 1;
+  }
+
+  Track track;
+  vector<string> lines;
+
+  if (options.replay.empty() && !track.load(options.map_file)) {
+
+    fprintf(stderr, "could not read the map %s\n", options.map_file.c_str());
+    return 1;
+  }
+
+  if (!options.replay.empty()) {
+
+    ifstream in(options.replay.c_str());
+
+    for (string line; getline(in, line); )
+      if (line.compare(0, 14, "42[\"telemetry\"") == 0 && line.find('{') != string::npos) lines.push_back(line);
+
+    if (lines.empty()) { fprintf(stderr, "no telemetry messages in %s\n", options.replay.c_str()); return 1; }
+  }
+
+  printf("%s telemetry at %.1f Hz per client, %.0f s measured per step, p99 target %.0f ms\n",
+         options.replay.empty() ? "synthetic" : options.replay.c_str(), options.rate, options.duration, options.p99);
+
+  printf("clients  sent/s  replies/s  drop%%  (supersede/timeout/backup)    p50 ms   p90 ms   p99 ms   max ms  "
+         "worst p99  planner cores  cpu%%/session  sessions/core  generator cores\n");
+
+  vector<unique_ptr<Client>> clients;
+
+  int within = 0;
+  double within_p99 = 0, within_cores = 0;
+
+  for (int n = options.clients; n <= options.max; n = options.step > 0 ? n + options.step : n * 2) {
+
+    if (!add_clients(clients, n, options, track)) break;
+
+    double planner_cpu = 0, generator_cpu = 0, worst_p99 = 0;
+
+    LoadStats stats = run_step(clients, options, track, lines, planner_cpu, generator_cpu, worst_p99);
+
+    int open = count_if(clients.begin(), clients.end(), [](const unique_ptr<Client> & c) { return c->open; });
+
+    if (open < n) fprintf(stderr, "%d of %d clients disconnected\n", n - open, n);
+
+    double p50 = quantile(stats.latency, .5), p90 = quantile(stats.latency, .9), p99 = quantile(stats.latency, .99);
+    double worst = stats.latency.empty() ? 0 : *max_element(stats.latency.begin(), stats.latency.end());
+
+    double cores = planner_cpu / options.duration;
+
+    printf("%7d %7.1f %10.1f %6.2f  (%ld/%ld/%ld) %*s %8.2f %8.2f %8.2f %8.2f %10.2f",
+           n, stats.sent / options.duration, stats.answered / options.duration,
+           stats.sent ? 100.0 * stats.dropped() / stats.sent : 0,
+           stats.superseded, stats.timed_out, stats.backed_up, 1, "",
+           p50, p90, p99, worst, worst_p99);
+
+    if (options.pid) printf(" %14.2f %13.2f %14.1f", cores, 100 * cores / n, cores > 0 ? n / cores : 0);
+    else             printf(" %14s %13s %14s", "-", "-", "-");
+
+    printf(" %16.2f\n", generator_cpu / options.duration);
+
+    fflush(stdout);
+
+    bool over = stats.answered == 0 || p99 > options.p99;
+
+    if (!over) { within = n; within_p99 = p99; within_cores = cores; }
+
+    if (!options.sweep || over) break;
+  }
+
+  if (options.sweep) {
+
+    if (within == 0) printf("p99 above %.0f ms from %d clients on\n", options.p99, options.clients);
+    else if (options.pid && within_cores > 0)
+      printf("capacity: %d sessions at p99 %.2f ms, %.2f planner cores, %.1f sessions per core\n",
+             within, within_p99, within_cores, within / within_cores);
+    else
+      printf("capacity: %d sessions at p99 %.2f ms\n", within, within_p99);
+  }
+
+  for (unique_ptr<Client> & client : clients) if (client->fd >= 0) close(client->fd);
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ Lane change template benchmark.
+
+ Drives the track at 49 mph, 3 points consumed per cycle, changing to
+ the right lane and back every 500 m, once with the lane change spline
+ through target lane anchors and once with the templates. Reports the
+ Waypoints cost of keep lane and lane change cycles and the peaks the
+ FeasibilityChecker sees. Reads ../data/highway_map.csv, run it from
+ the build directory.
+
+ usage: ./maneuver_bench [iterations]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Behavior_planning/spline.h"
+#include "Behavior_planning/feasibility.h"
+#include "Behavior_planning/maneuver_templates.h"
+#include "Behavior_planning/path_smoother.h"
+#include "helper_functions.h"
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 20;
+
+  vector<double> map_x, map_y, map_s, map_dx, map_dy;
+
+  load_Waypoints(map_x, map_y, map_s, map_dx, map_dy);
+
+  if (map_s.empty()) {
+
+    printf("no map, run from the build directory\n");
+    return 1;
+  }
+
+  ManeuverTemplates templates;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  templates.build();
+
+  chrono::duration<double, milli> build_ms = chrono::steady_clock::now() - start;
+
+  int feasible = 0;
+
+  for (char f : templates.feasible) feasible += f;
+
+  printf("%d templates (%d speeds x %d durations, %d feasible), %zu KB, built in %.2f ms\n",
+         (int) templates.steps.size(), templates.speed_bins, templates.num_durations, feasible,
+         (templates.lateral.size() + templates.advance.size()) * sizeof(float) / 1024,
+         build_ms.count());
+
+  FeasibilityChecker checker;
+
+  double ref_vel = 49;  //[mph]
+  double step    = 0.02 * ref_vel / 2.24;
+
+  for (int use_templates = 0; use_templates < 2; use_templates++) {
+
+    vector<double> behind = getXY(10 - step, 6, map_s, map_x, map_y);
+    vector<double> origin = getXY(10, 6, map_s, map_x, map_y);
+
+    vector<double> path_x = {behind[0], origin[0]}, path_y = {behind[1], origin[1]};
+
+    LaneChange lane_change;
+
+    double end_s = 10, keep_us = 0, change_us = 0, jerk = 0, lat_accel = 0;
+    int    keep_cycles = 0, change_cycles = 0, infeasible = 0, lane = 1;
+
+    while (end_s < map_s.back() - 200) {
+
+      int from_lane = lane;
+
+      lane = (int) (end_s / 500) % 2 ? 2 : 1;
+
+      if (use_templates && lane != from_lane) {
+
+        double from_d = lane_change.active() ? lane_change.d(templates, lane_change.step - 1)
+                                             : 2 + 4 * from_lane;
+
+        lane_change.id     = templates.select(ref_vel / 2.24);
+        lane_change.step   = 0;
+        lane_change.from_d = from_d;
+        lane_change.to_d   = 2 + 4 * lane;
+      }
+
+      // a lane change cycle until the end of the path is in the lane
+      int    n       = path_x.size();
+      double theta   = atan2(path_y[n-1] - path_y[n-2], path_x[n-1] - path_x[n-2]);
+      double end_d   = getFrenet(path_x[n-1], path_y[n-1], theta, map_x, map_y)[1];
+      bool   changing = fabs(end_d - (2 + 4 * lane)) > 0.2;
+
+      LaneChange state = lane_change;
+
+      Waypoints wp(path_x.size(), lane, path_x.back(), path_y.back(), 0, end_s,
+                   map_s, map_x, map_y, path_x, path_y);
+
+      chrono::steady_clock::time_point cycle = chrono::steady_clock::now();
+
+      for (int i = 0; i < iterations; i++) {
+
+        lane_change = state;
+
+        wp = Waypoints(path_x.size(), lane, path_x.back(), path_y.back(), 0, end_s,
+                       map_s, map_x, map_y, path_x, path_y);
+
+        if (use_templates) {
+
+          wp.templates   = &templates;
+          wp.lane_change = &lane_change;
+        }
+
+        wp.spaced_waypoints_generator();
+        wp.detailed_waypoints_generator(ref_vel);
+      }
+
+      chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - cycle;
+
+      if (changing) {
+
+        change_us += elapsed.count() / iterations;
+        change_cycles++;
+
+      } else {
+
+        keep_us += elapsed.count() / iterations;
+        keep_cycles++;
+      }
+
+      checker.check(wp.next_x_vals, wp.next_y_vals);
+
+      jerk        = max(jerk, checker.stats.jerk);
+      lat_accel   = max(lat_accel, checker.stats.lat_accel);
+      infeasible += checker.stats.first >= 0;
+
+      path_x.assign(wp.next_x_vals.begin() + 3, wp.next_x_vals.end());
+      path_y.assign(wp.next_y_vals.begin() + 3, wp.next_y_vals.end());
+
+      n     = path_x.size();
+      theta = atan2(path_y[n-1] - path_y[n-2], path_x[n-1] - path_x[n-2]);
+      end_s = getFrenet(path_x[n-1], path_y[n-1], theta, map_x, map_y)[0];
+    }
+
+    printf("%-9s keep lane %6.2f us/cycle (%d), lane change %6.2f us/cycle (%d),"
+           " %d infeasible paths, peaks %.2f m/s^3, %.2f m/s^2 lateral\n",
+           use_templates ? "templates" : "spline", keep_us / keep_cycles, keep_cycles,
+           change_us / max(1, change_cycles), change_cycles, infeasible, jerk, lat_accel);
+  }
+
+  return 0;
+}
@@ -0,0 +1,321 @@
+/*
+ Planner hot function microbenchmarks.
+
+ Times the functions every telemetry message goes through, one at a
+ time, on fixed inputs: the map of data/highway_map.csv and 64
+ sensor_fusion frames, 12 vehicles in 3 lanes placed along the whole
+ track (or the frames of a recorded telemetry file, the lines of
+ 42["telemetry",{...}] messages as load_generator --replay takes).
+
+ Reports ns/op, heap allocations/op, bytes/op and instructions/op
+ (perf_event_open, user space; null where the kernel exposes no
+ hardware counters) and writes them as JSON for comparison across
+ builds.
+
+ usage: ./planner_bench [iterations] [json file] [telemetry file]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <vector>
+#include "json.hpp"
+
+#include "Behavior_planning/spline.h"
+#include "Behavior_planning/alloc_accounting.h"
+#include "Behavior_planning/path_smoother.h"
+#include "Behavior_planning/maneuver_templates.h"
+#include "Behavior_planning/road.h"
+#include "Behavior_planning/vehicle.h"
+#include "helper_functions.h"
+#include "traffic.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+/*
+ User space instructions retired by this thread, -1 when the counter
+ cannot be opened (no PMU in a VM, perf_event_paranoid).
+*/
+class InstructionCounter {
+public:
+
+  InstructionCounter() {
+
+#ifdef __linux__
+    perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+
+    if (fd_ >= 0) ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  ~InstructionCounter() { if (fd_ >= 0) close(fd_); }
+
+  long read() const {
+
+    long count = -1;
+
+    if (fd_ < 0 || ::read(fd_, &count, sizeof(count)) != sizeof(count)) return -1;
+
+    return count;
+  }
+
+private:
+
+  int fd_ = -1;
+};
+
+static InstructionCounter instructions;
+
+static json results = json::array();
+
+template <typename F>
+static void run(const char * name, int iterations, F f)
+{
+
+  for (int i = 0; i < iterations / 10 + 1; i++) f();
+
+  // heap use counted by the operator new of alloc_hooks.cpp
+  AllocStats start_heap   = AllocAccounting::stats(0);
+  long start_instructions = instructions.read();
+  auto start = chrono::steady_clock::now();
+
+  for (int i = 0; i < iterations; i++) f();
+
+  auto stop = chrono::steady_clock::now();
+  long stop_instructions = instructions.read();
+
+  double ns     = chrono::duration<double, nano>(stop - start).count() / iterations;
+  AllocStats stop_heap = AllocAccounting::stats(0);
+
+  double allocs = (double) (stop_heap.total_allocations() - start_heap.total_allocations()) / iterations;
+  double bytes  = (double) (stop_heap.total_bytes() - start_heap.total_bytes()) / iterations;
+
+  json result;
+
+  result["name"]          = name;
+  result["iterations"]    = iterations;
+  result["ns_per_op"]     = ns;
+  result["allocs_per_op"] = allocs;
+  result["bytes_per_op"]  = bytes;
+
+  if (start_instructions >= 0 && stop_instructions >= 0) {
+
+    double per_op = (double) (stop_instructions - start_instructions) / iterations;
+
+    result["instructions_per_op"] = per_op;
+
+    printf("%-36s %10.1f ns/op %8.2f allocs/op %9.0f B/op %10.0f instr/op\n", name, ns, allocs, bytes, per_op);
+
+  } else {
+
+    result["instructions_per_op"] = nullptr;
+
+    printf("%-36s %10.1f ns/op %8.2f allocs/op %9.0f B/op %10s instr/op\n", name, ns, allocs, bytes, "-");
+  }
+
+  results.push_back(result);
+}
+
+static vector<Telemetry> load_frames(const string & file)
+{
+
+  vector<Telemetry> frames;
+
+  ifstream in(file.c_str());
+
+  for (string line; getline(in, line); ) {
+
+    if (line.compare(0, 14, "42[\"telemetry\"") != 0) continue;
+
+    json data = json::parse(line.substr(2))[1];
+
+    Telemetry frame;
+
+    frame.car_x   = data["x"];
+    frame.car_y   = data["y"];
+    frame.car_s   = data["s"];
+    frame.car_d   = data["d"];
+    frame.car_yaw = data["yaw"];
+
+    frame.previous_path_x = data["previous_path_x"].get<vector<double>>();
+    frame.previous_path_y = data["previous_path_y"].get<vector<double>>();
+    frame.sensor_fusion   = data["sensor_fusion"].get<vector<vector<double>>>();
+
+    frames.push_back(frame);
+  }
+  return frames;
+}
+
+int main(int argc, char * argv[])
+{
+
+  int    iterations = argc > 1 ? atoi(argv[1]) : 20000;
+  string json_file  = argc > 2 ? argv[2] : "planner_bench.json";
+
+  vector<double> maps_x, maps_y, maps_s, maps_dx, maps_dy;
+
+  load_Waypoints(maps_x, maps_y, maps_s, maps_dx, maps_dy);
+
+  if (maps_x.empty()) { fprintf(stderr, "no map, run from a directory next to data/\n"); return 1; }
+
+  auto xy = [&](double s, double d) { return getXY(s, d, maps_s, maps_x, maps_y); };
+
+  vector<Telemetry> frames = argc > 3 ? load_frames(argv[3]) : make_frames(64, xy);
+
+  if (frames.empty()) { fprintf(stderr, "no telemetry frames in %s\n", argv[3]); return 1; }
+
+  int n = frames.size();
+
+  PlannerConfig config;
+
+  Road road(config.speed_limit, config.lane_speeds);
+
+  road.add_ego(1, 0, 20, config.ego_config());
+  road.configure(config);
+
+  mute_planner_log();
+
+  // predictions and a configured ego of a mid track frame
+  const Telemetry & mid = frames[n / 2];
+
+  road.ego_localization(mid.car_s);
+  road.add_vehicles_surrounding(mid.sensor_fusion, mid.previous_path_x.size(), .06);
+  road.behavior_planning();
+
+  const map<int, vector<Vehicle>> & predictions = road.predictions;
+
+  Vehicle ego = road.get_ego();
+
+  Trajectory keep_lane = ego.generate_trajectory(State::KL, predictions);
+
+  Vehicle traffic = road.tracks[0].vehicle;
+
+  vector<Vehicle> traffic_predictions;
+
+  volatile double checksum = 0;
+  int k = 0;
+
+  printf("iterations: %d, frames: %d, %d vehicles in the mid frame\n",
+         iterations, n, (int) mid.sensor_fusion.size());
+
+  run("ClosestWaypoint", iterations, [&]() {
+    const Telemetry & f = frames[k++ % n];
+    checksum += ClosestWaypoint(f.car_x, f.car_y, maps_x, maps_y);
+  });
+
+  run("NextWaypoint", iterations, [&]() {
+    const Telemetry & f = frames[k++ % n];
+    checksum += NextWaypoint(f.car_x, f.car_y, deg2rad(f.car_yaw), maps_x, maps_y);
+  });
+
+  run("getFrenet", iterations, [&]() {
+    const Telemetry & f = frames[k++ % n];
+    checksum += getFrenet(f.car_x, f.car_y, deg2rad(f.car_yaw), maps_x, maps_y)[0];
+  });
+
+  run("getXY", iterations, [&]() {
+    const Telemetry & f = frames[k++ % n];
+    checksum += getXY(f.car_s + 30, f.car_d, maps_s, maps_x, maps_y)[0];
+  });
+
+  // the anchors of a cycle: 2 from the previous path, 3 ahead, car frame
+  vector<double> ptsx = {-0.4, 0, 30, 60, 90}, ptsy = {0, 0, .3, 1.2, 2.6};
+
+  run("tk::spline::set_points", iterations, [&]() {
+    tk::spline s;
+    s.set_points(ptsx, ptsy);
+    checksum += s(15);
+  });
+
+  tk::spline spline;
+  spline.set_points(ptsx, ptsy);
+
+  run("tk::spline::operator()", iterations, [&]() {
+    checksum += spline((k++ % 300) * .1);
+  });
+
+  run("Waypoints construct", iterations, [&]() {
+    const Telemetry & f = frames[k++ % n];
+    Waypoints wp(f.previous_path_x.size(), 1, f.car_x, f.car_y, f.car_yaw, f.car_s,
+                 maps_s, maps_x, maps_y, f.previous_path_x, f.previous_path_y);
+    checksum += wp.prev_size;
+  });
+
+  // one Waypoints per frame, cleared between calls as a fresh one would be
+  vector<Waypoints> waypoints;
+
+  for (const Telemetry & f : frames)
+    waypoints.push_back(Waypoints(f.previous_path_x.size(), 1, f.car_x, f.car_y, f.car_yaw, f.car_s + 18,
+                                  maps_s, maps_x, maps_y, f.previous_path_x, f.previous_path_y));
+
+  run("spaced_waypoints_generator", iterations, [&]() {
+    Waypoints & wp = waypoints[k++ % n];
+    wp.ptsx.clear();
+    wp.ptsy.clear();
+    wp.spaced_waypoints_generator();
+    checksum += wp.ptsy.back();
+  });
+
+  run("detailed_waypoints_generator", iterations, [&]() {
+    Waypoints & wp = waypoints[k++ % n];
+    wp.next_x_vals.clear();
+    wp.next_y_vals.clear();
+    wp.detailed_waypoints_generator(44.8);
+    checksum += wp.next_x_vals.back();
+  });
+
+  run("Road::add_vehicles_surrounding", iterations, [&]() {
+    const Telemetry & f = frames[k++ % n];
+    road.add_vehicles_surrounding(f.sensor_fusion, f.previous_path_x.size(), .06);
+  });
+
+  run("Vehicle::generate_predictions", iterations, [&]() {
+    traffic.generate_predictions(traffic_predictions);
+    checksum += traffic_predictions.back().s;
+  });
+
+  run("Vehicle::choose_next_state", iterations, [&]() {
+    checksum += ego.choose_next_state(predictions).size();
+  });
+
+  run("calculate_cost", iterations, [&]() {
+    checksum += calculate_cost(ego, predictions, keep_lane);
+  });
+
+  cout.clear();
+
+  json report;
+
+  report["benchmark"]  = "planner_bench";
+  report["compiler"]   = __VERSION__;
+  report["frames"]     = n;
+  report["results"]    = results;
+
+  ofstream out(json_file.c_str());
+
+  out << report.dump(2) << endl;
+
+  printf("wrote %s\n", out ? json_file.c_str() : "nothing, could not open the json file");
+
+  return out ? 0 : 1;
+}
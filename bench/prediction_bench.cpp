@@ -0,0 +1,64 @@
+/*
+ Prediction rollout benchmark.
+
+ Rolls out synthetic traffic of 10 to 1000 vehicles over a 5 s
+ horizon at 0.1 s steps with both motion models.
+
+ usage: ./prediction_bench [iterations]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "Behavior_planning/prediction.h"
+
+static void fill_traffic(Prediction & prediction, int num_vehicles)
+{
+
+  prediction.clear();
+
+  for (int i = 0; i < num_vehicles; i++) {
+
+    int   lane  = i % prediction.num_lanes;
+    float s     = 10.0f * i;
+    float d     = 2.0f + 4.0f * lane;
+    float v     = 15.0f + (i % 7);
+    float a     = (i % 5) - 2.0f;
+    float d_dot = (i % 11 == 0) ? 1.0f : 0.0f;
+
+    prediction.add(i, s, d, v, a, d_dot);
+  }
+}
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+
+  Prediction prediction(5.0, 0.1);
+
+  printf("horizon: %.1f s, dt: %.2f s, steps: %d\n",
+         prediction.horizon, prediction.dt, prediction.steps);
+
+  int counts[] = {10, 50, 100, 500, 1000};
+
+  for (int num_vehicles : counts) {
+
+    for (int model = 0; model < 2; model++) {
+
+      fill_traffic(prediction, num_vehicles);
+
+      auto start = chrono::steady_clock::now();
+
+      for (int i = 0; i < iterations; i++) prediction.rollout((Prediction::Model) model);
+
+      auto   stop = chrono::steady_clock::now();
+      double us   = chrono::duration<double, micro>(stop - start).count() / iterations;
+
+      printf("%5d vehicles %-22s %8.2f us/rollout %7.2f ns/vehicle-step\n", num_vehicles,
+             model ? "constant acceleration" : "constant velocity",
+             us, 1000 * us / (num_vehicles * prediction.steps));
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ Frenet sampler benchmark.
+
+ Plans against 12 predicted vehicles on 3 lanes with grids of 144 to
+ 4608 candidates, scored on the caller only and on the thread pool.
+
+ usage: ./sampler_bench [iterations]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include "Behavior_planning/frenet_sampler.h"
+#include "Behavior_planning/prediction.h"
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 200;
+
+  Prediction prediction(5.0, 0.1);
+
+  for (int i = 0; i < 12; i++) {
+
+    int lane = i % 3;
+
+    prediction.add(i, 980.0f + 15.0f * i, 2.0f + 4.0f * lane, 12.0f + lane * 3, 0, 0);
+  }
+
+  prediction.rollout();
+
+  printf("vehicles: %d, steps: %d\n", prediction.size, prediction.steps);
+
+  int grids[][2] = {{8, 6}, {16, 9}, {32, 16}, {64, 24}};
+
+  for (auto & grid : grids) {
+
+    for (int parallel = 0; parallel < 2; parallel++) {
+
+      FrenetSampler sampler;
+
+      sampler.num_speeds         = grid[0];
+      sampler.num_horizons       = grid[1];
+      sampler.parallel_threshold = parallel ? 0 : 1 << 30;
+
+      double elapsed_ms = 0;
+
+      for (int i = 0; i < iterations; i++) {
+
+        sampler.plan(1000.0f, 20.0f, 0, 6.0f, 1, prediction);
+        elapsed_ms += sampler.stats.elapsed_ms;
+      }
+
+      int best = sampler.best;
+
+      printf("%5d candidates %d thread(s) %9.1f us/plan %8.1f candidates/ms"
+             "  best: lane %d, %.1f m/s, T %.1f s, %d colliding\n",
+             sampler.stats.candidates, sampler.stats.threads,
+             1000 * elapsed_ms / iterations, sampler.stats.candidates * iterations / elapsed_ms,
+             sampler.lane[best], sampler.v1[best], sampler.T[best], sampler.stats.collisions);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ Multi-rate behavior scheduler benchmark.
+
+ Simulates 12 vehicles at 14 to 24 m/s on 3 lanes around the ego, one
+ telemetry message every 3 path points (60 ms), and runs the FSM every
+ message and under BehaviorScheduler settings. Reports behavior cycles
+ per message, the cost per message and the decisions taken, so the
+ savings can be weighed against how the ego ends up driving.
+
+ usage: ./scheduler_bench [messages]
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include "Behavior_planning/road.h"
+#include "Behavior_planning/behavior_scheduler.h"
+#include "traffic.h"
+
+struct Setting {
+
+  const char * name;
+
+  bool   multi_rate;
+
+  double period;     //[s]
+
+  bool   on_events;
+};
+
+int main(int argc, char * argv[])
+{
+
+  int messages = argc > 1 ? atoi(argv[1]) : 5000;
+
+  int SPEED_LIMIT         = 49;
+  vector<int> LANE_SPEEDS = {49, 49, 49};
+  int MAX_ACCEL           = 10;
+  vector<int> GOAL        = {6945, 1};
+
+  int num_lanes          = LANE_SPEEDS.size();
+  vector<int> ego_config = {SPEED_LIMIT, num_lanes, GOAL[0],
+                            GOAL[1], MAX_ACCEL, SPEED_LIMIT};
+
+  const Setting settings[] = {
+    {"every message",        false, 0.0, false},
+    {"5 Hz",                 true,  0.2, false},
+    {"2 Hz + events",        true,  0.5, true },
+    {"1 Hz + events",        true,  1.0, true },
+  };
+
+  mute_planner_log();
+
+  printf("messages: %d, 60 ms apart\n", messages);
+
+  for (const Setting & setting : settings) {
+
+    Road road = Road(SPEED_LIMIT, LANE_SPEEDS);
+    road.add_ego(1, 0, 0, ego_config);
+
+    BehaviorScheduler scheduler;
+
+    scheduler.period    = setting.period;
+    scheduler.on_events = setting.on_events;
+
+    double ego_s = 0, ref_vel = 0, t = 0, behavior_us = 0, mean_v = 0;
+    int    lane_changes = 0, lane = 1;
+
+    for (int m = 0; m < messages; m++) {
+
+      t += .06;
+
+      road.ego_localization(ego_s);
+      road.add_vehicles_surrounding(ring_traffic(t), 0, .06);
+
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+      if (!setting.multi_rate || scheduler.due(road, t)) road.behavior_planning();
+
+      behavior_us += chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+
+      Vehicle ego = road.get_ego();
+
+      lane_changes += ego.lane != lane;
+      lane          = ego.lane;
+
+      // the ref_vel ramp of main, 3 points per message
+      for (int k = 0; k < 3; k++) {
+
+        if      (ref_vel > ego.v) ref_vel -= .224 * 2;
+        else if (ref_vel < ego.v) ref_vel += .224 * 2;
+
+        ego_s = fmod(ego_s + ref_vel / 2.24 * .02, 6945.554);
+      }
+
+      mean_v += ref_vel / messages;
+    }
+
+    const SchedulerStats & stats = scheduler.stats;
+
+    printf("%-14s %5.3f behavior cycles/message, %7.2f us/message,"
+           " %3d lane changes, mean %.1f mph",
+           setting.name, setting.multi_rate ? stats.behavior_cycles_per_message() : 1.0,
+           behavior_us / messages, lane_changes, mean_v);
+
+    if (setting.multi_rate)
+      printf(" (%ld deadline, %ld occupancy)",
+             stats.triggers[static_cast<int>(Trigger::DEADLINE)],
+             stats.triggers[static_cast<int>(Trigger::OCCUPANCY)]);
+
+    printf("\n");
+  }
+
+  cout.clear();
+
+  return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ Shared memory transport benchmark.
+
+ A forked child plays the simulator: it sends a telemetry message
+ (50 previous path points, 12 vehicles) and waits for the 50 point
+ path back, the parent answers with a fixed path. Times the round trip
+ over ShmTransport and over a socketpair carrying the same messages as
+ JSON text, the way they cross the WebSocket, so the transport and
+ serialization cost is all that is measured.
+
+ usage: ./shm_bench [round trips]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "json.hpp"
+#include "Behavior_planning/shm_transport.h"
+
+using json = nlohmann::json;
+
+static Telemetry make_telemetry()
+{
+
+  Telemetry telemetry;
+
+  telemetry.car_x = 909.48; telemetry.car_y = 1128.67; telemetry.car_s = 124.83;
+  telemetry.car_d = 6.16;   telemetry.car_yaw = 0;     telemetry.car_speed = 49.5;
+
+  for (int i = 0; i < 50; i++) {
+
+    telemetry.previous_path_x.push_back(909.48 + .44 * i);
+    telemetry.previous_path_y.push_back(1128.67);
+  }
+
+  for (int id = 0; id < 12; id++)
+    telemetry.sensor_fusion.push_back({(double) id, 900. + 30 * id, 1130, 20, 0, 120. + 30 * id, 2. + 4 * (id % 3)});
+
+  return telemetry;
+}
+
+static Control make_control(const Telemetry & telemetry)
+{
+
+  Control control;
+
+  control.next_x = telemetry.previous_path_x;
+  control.next_y = telemetry.previous_path_y;
+
+  return control;
+}
+
+static string telemetry_message(const Telemetry & telemetry)
+{
+
+  json data;
+
+  data["x"] = telemetry.car_x; data["y"] = telemetry.car_y; data["s"] = telemetry.car_s;
+  data["d"] = telemetry.car_d; data["yaw"] = telemetry.car_yaw; data["speed"] = telemetry.car_speed;
+  data["previous_path_x"] = telemetry.previous_path_x;
+  data["previous_path_y"] = telemetry.previous_path_y;
+  data["end_path_s"] = telemetry.end_path_s;
+  data["end_path_d"] = telemetry.end_path_d;
+  data["sensor_fusion"] = telemetry.sensor_fusion;
+
+  return "42[\"telemetry\"," + data.dump() + "]";
+}
+
+static void parse_telemetry(const string & message, Telemetry & telemetry)
+{
+
+  json data = json::parse(message.substr(2))[1];
+
+  telemetry.car_x = data["x"]; telemetry.car_y = data["y"]; telemetry.car_s = data["s"];
+  telemetry.car_d = data["d"]; telemetry.car_yaw = data["yaw"]; telemetry.car_speed = data["speed"];
+  telemetry.previous_path_x = data["previous_path_x"].get<vector<double>>();
+  telemetry.previous_path_y = data["previous_path_y"].get<vector<double>>();
+  telemetry.end_path_s = data["end_path_s"];
+  telemetry.end_path_d = data["end_path_d"];
+  telemetry.sensor_fusion = data["sensor_fusion"].get<vector<vector<double>>>();
+}
+
+static string control_message(const Control & control)
+{
+
+  json msgJson;
+
+  msgJson["next_x"] = control.next_x;
+  msgJson["next_y"] = control.next_y;
+
+  return "42[\"control\"," + msgJson.dump() + "]";
+}
+
+// length prefixed frames, a stand in for WebSocket framing
+static bool write_frame(int fd, const string & frame)
+{
+
+  uint32_t size = frame.size();
+
+  return write(fd, &size, sizeof(size)) == sizeof(size)
+      && write(fd, frame.data(), size) == (ssize_t) size;
+}
+
+static bool read_frame(int fd, string & frame)
+{
+
+  uint32_t size;
+
+  if (read(fd, &size, sizeof(size)) != sizeof(size)) return false;
+
+  frame.resize(size);
+
+  for (uint32_t got = 0; got < size; ) {
+
+    ssize_t n = read(fd, &frame[got], size - got);
+
+    if (n <= 0) return false;
+    got += n;
+  }
+  return true;
+}
+
+static bool read_results(int fd, vector<double> & us)
+{
+
+  char * p = (char *) us.data();
+
+  for (size_t left = sizeof(double) * us.size(); left > 0; ) {
+
+    ssize_t n = read(fd, p, left);
+
+    if (n <= 0) return false;
+    p += n; left -= n;
+  }
+  return true;
+}
+
+static void report(const char * name, vector<double> & us)
+{
+
+  sort(us.begin(), us.end());
+
+  printf("%-14s p50 %7.2f us  p99 %7.2f us  max %8.2f us\n", name,
+         us[us.size() / 2], us[us.size() * 99 / 100], us.back());
+}
+
+// the child's side of both runs, writes the round trip times to the pipe
+static void simulator(int round_trips, const string & name, int socket, int results)
+{
+
+  Telemetry telemetry = make_telemetry();
+  vector<double> us(round_trips);
+
+  ShmTransport shm;
+
+  while (!shm.attach(name)) usleep(1000);
+
+  TelemetryRecord out;
+  ControlRecord   in;
+  Control         control;
+
+  for (int i = 0; i < round_trips; i++) {
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    to_record(telemetry, i, out);
+    shm.send(out);
+    while (!shm.receive(in, 1000)) {}
+    from_record(in, control);
+
+    us[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+  }
+
+  if (write(results, us.data(), sizeof(double) * round_trips) < 0) exit(1);
+
+  string frame;
+
+  for (int i = 0; i < round_trips; i++) {
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    write_frame(socket, telemetry_message(telemetry));
+    read_frame(socket, frame);
+
+    json data = json::parse(frame.substr(2))[1];
+    control.next_x = data["next_x"].get<vector<double>>();
+    control.next_y = data["next_y"].get<vector<double>>();
+
+    us[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+  }
+
+  if (write(results, us.data(), sizeof(double) * round_trips) < 0) exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+
+  int round_trips = argc > 1 ? atoi(argv[1]) : 20000;
+
+  string name = "/shm_bench_" + to_string(getpid());
+
+  int sockets[2], results[2];
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0 || pipe(results) != 0) return 1;
+
+  ShmTransport shm;
+
+  if (!shm.create(name)) { fprintf(stderr, "shm_open %s failed\n", name.c_str()); return 1; }
+
+  pid_t child = fork();
+
+  if (child == 0) {
+
+    simulator(round_trips, name, sockets[1], results[1]);
+    _exit(0);
+  }
+
+  TelemetryRecord in;
+  ControlRecord   out;
+  Telemetry       telemetry;
+
+  for (int i = 0; i < round_trips; i++) {
+
+    while (!shm.receive(in, 1000)) {}
+    from_record(in, telemetry);
+    to_record(make_control(telemetry), in.seq, out);
+    shm.send(out);
+  }
+
+  // read before the next run, the times do not fit the pipe buffer
+  vector<double> shm_us(round_trips), socket_us(round_trips);
+
+  if (!read_results(results[0], shm_us)) return 1;
+
+  string frame;
+
+  for (int i = 0; i < round_trips; i++) {
+
+    read_frame(sockets[0], frame);
+    parse_telemetry(frame, telemetry);
+    write_frame(sockets[0], control_message(make_control(telemetry)));
+  }
+
+  if (!read_results(results[0], socket_us)) return 1;
+
+  waitpid(child, nullptr, 0);
+
+  printf("%d round trips, 50 path points, 12 vehicles\n", round_trips);
+
+  report("shm ring", shm_us);
+  report("socket + json", socket_us);
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ Reference path smoother benchmark.
+
+ Smooths the middle lane reference path over the first 90 m past car
+ s every 50 m around the track, with 100, 150 and 200 nodes, and
+ compares the peak curvature of the spline through the raw getXY
+ anchors and through the smoothed ones. Reads ../data/highway_map.csv, run it from the build directory.
+
+ usage: ./smoother_bench [iterations]
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Behavior_planning/spline.h"
+#include "Behavior_planning/maneuver_templates.h"
+#include "Behavior_planning/path_smoother.h"
+#include "helper_functions.h"
+
+// peak curvature of the anchor spline of Waypoints, sampled every 0.5 m
+static double peak_curvature(const Waypoints & wp)
+{
+
+  tk::spline spline;
+
+  spline.set_points(wp.ptsx, wp.ptsy);
+
+  double peak = 0, h = 0.5;
+
+  for (double x = h; x < wp.ptsx.back() - h; x += h) {
+
+    double y0 = spline(x - h), y1 = spline(x), y2 = spline(x + h);
+
+    double dy  = (y2 - y0) / (2 * h);
+    double ddy = (y2 - 2 * y1 + y0) / (h * h);
+
+    peak = max(peak, fabs(ddy) / pow(1 + dy * dy, 1.5));
+  }
+
+  return peak;
+}
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 10;
+
+  vector<double> map_x, map_y, map_s, map_dx, map_dy;
+
+  load_Waypoints(map_x, map_y, map_s, map_dx, map_dy);
+
+  if (map_s.empty()) {
+
+    printf("no map, run from the build directory\n");
+    return 1;
+  }
+
+  int sizes[] = {100, 150, 200};
+
+  for (int size : sizes) {
+
+    PathSmoother smoother;
+
+    smoother.spacing = 90.0 / (size - 1);
+
+    double elapsed_ms = 0, worst_ms = 0, raw_peak = 0, smoothed_peak = 0;
+    int    paths = 0, factorizations = 0, analyses = 0, active = 0;
+
+    for (int i = 0; i < iterations; i++) {
+
+      for (double car_s = 10; car_s < map_s.back() - 100; car_s += 50) {
+
+        // the previous path ends at car s in the middle lane
+        vector<double> behind = getXY(car_s - 1, 6, map_s, map_x, map_y);
+        vector<double> xy     = getXY(car_s, 6, map_s, map_x, map_y);
+
+        Waypoints wp(2, 1, xy[0], xy[1], 0, car_s, map_s, map_x, map_y,
+                     {behind[0], xy[0]}, {behind[1], xy[1]});
+
+        Waypoints raw = wp;
+
+        raw.spaced_waypoints_generator();
+
+        wp.smoother = &smoother;
+        wp.spaced_waypoints_generator();
+
+        const SmootherStats & stats = smoother.stats;
+
+        elapsed_ms     += stats.elapsed_ms;
+        worst_ms        = max(worst_ms, stats.elapsed_ms);
+        factorizations += stats.iterations;
+        analyses       += stats.analyzed;
+        active         += stats.active;
+        paths++;
+
+        raw_peak      += peak_curvature(raw);
+        smoothed_peak += peak_curvature(wp);
+      }
+    }
+
+    printf("%3d nodes %7.4f ms/path (worst %.4f) %.2f factorizations/path, %d symbolic, %.1f nodes at the corridor"
+           "  mean peak spline curvature raw %.5f smoothed %.5f 1/m\n",
+           smoother.stats.nodes, elapsed_ms / paths, worst_ms, (double) factorizations / paths,
+           analyses, (double) active / paths, raw_peak / paths, smoothed_peak / paths);
+  }
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ s-t speed planner benchmark.
+
+ Plans in the middle lane behind a slower vehicle at row spacings from
+ 0.4 m down to 0.05 m, relaxed on the caller only and on the thread
+ pool.
+
+ usage: ./speed_planner_bench [iterations]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include "Behavior_planning/prediction.h"
+#include "Behavior_planning/speed_planner.h"
+
+int main(int argc, char * argv[])
+{
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 100;
+
+  Prediction prediction(5.0, 0.1);
+
+  for (int i = 0; i < 12; i++) {
+
+    int lane = i % 3;
+
+    prediction.add(i, 1010.0f + 15.0f * i, 2.0f + 4.0f * lane, 12.0f + lane * 3, 0, 0);
+  }
+
+  prediction.rollout();
+
+  float spacings[] = {0.4f, 0.2f, 0.1f, 0.05f};
+
+  for (float ds : spacings) {
+
+    for (int parallel = 0; parallel < 2; parallel++) {
+
+      SpeedPlanner planner;
+
+      planner.ds                 = ds;
+      planner.dt                 = 0.25f;
+      planner.parallel_threshold = parallel ? 0 : 1 << 30;
+
+      double elapsed_ms = 0;
+
+      for (int i = 0; i < iterations; i++) {
+
+        planner.plan(1000.0f, 20.0f, 0, 1, 21.9f, prediction);
+        elapsed_ms += planner.stats.elapsed_ms;
+      }
+
+      printf("%3dx%-5d grid %d thread(s) %8.3f ms/plan %6.2f ns/edge"
+             "  v(1s) %.1f v(4s) %.1f m/s%s\n",
+             planner.stats.columns, planner.stats.rows, planner.stats.threads,
+             elapsed_ms / iterations, 1e6 * elapsed_ms / iterations / planner.stats.edges,
+             planner.speed_at(1.0f), planner.speed_at(4.0f),
+             planner.stats.feasible ? "" : " (braking)");
+    }
+  }
+
+  return 0;
+}
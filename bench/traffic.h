@@ -0,0 +1,153 @@
+#ifndef BENCH_TRAFFIC_H
+#define BENCH_TRAFFIC_H
+#include <cmath>
+#include <iostream>
+#include <vector>
+#include "Behavior_planning/telemetry.h"
+
+using namespace std;
+
+/*
+ Synthetic traffic and telemetry of the benchmarks, so they all
+ measure on the same inputs.
+
+ Vehicle id drives in the center of lane id % lanes at
+ traffic_speed(id), 14 to 24 m/s, so leaders and gaps change over a
+ run. Where it is comes from the caller. x, y and the heading of vx,
+ vy come from a map projection xy(s, d) returning {x, y}, getXY for
+ instance; without one they are 0 and vx is the speed.
+*/
+
+const double TRACK_S = 6945.554;   //[m] s wraps back to 0 here
+
+inline double traffic_speed(int id) { return 14 + (id * 7) % 11; }
+
+struct NoMap {
+
+  vector<double> operator()(double, double) const { return {0, 0}; }
+};
+
+/*
+ [id, x, y, vx, vy, s, d] of vehicles 0 to vehicles - 1 on lanes lanes,
+ vehicle id at s_of(id, lane, speed) wrapped to the track.
+*/
+template <typename S, typename XY>
+void make_sensor_fusion(vector<vector<double>> & sensor_fusion, int vehicles, int lanes, S s_of, XY xy)
+{
+
+  sensor_fusion.resize(vehicles);
+
+  for (int id = 0; id < vehicles; id++) {
+
+    int    l = id % lanes;
+    double v = traffic_speed(id);
+    double d = 2.0 + 4 * l;
+    double s = fmod(fmod(s_of(id, l, v), TRACK_S) + TRACK_S, TRACK_S);
+
+    vector<double> p = xy(s, d);
+    vector<double> q = xy(s + 1, d);
+
+    double heading = atan2(q[1] - p[1], q[0] - p[0]);
+
+    sensor_fusion[id] = {(double) id, p[0], p[1], v * cos(heading), v * sin(heading), s, d};
+  }
+}
+
+template <typename S>
+void make_sensor_fusion(vector<vector<double>> & sensor_fusion, int vehicles, int lanes, S s_of)
+{
+
+  make_sensor_fusion(sensor_fusion, vehicles, lanes, s_of, NoMap());
+}
+
+/*
+ 12 vehicles on 3 lanes at time t [s], 60 m apart from s0 at t = 0.
+*/
+template <typename XY>
+vector<vector<double>> ring_traffic(double t, double s0, XY xy)
+{
+
+  vector<vector<double>> sensor_fusion;
+
+  make_sensor_fusion(sensor_fusion, 12, 3, [t, s0](int id, int, double v) { return s0 + 60 * id + v * t; }, xy);
+
+  return sensor_fusion;
+}
+
+inline vector<vector<double>> ring_traffic(double t, double s0 = 40)
+{
+
+  return ring_traffic(t, s0, NoMap());
+}
+
+/*
+ Four vehicles per lane around ego_s, 35 m apart, 18 m/s in lane 0 and
+ 2 m/s faster in each next lane. Fixed, for single cycle timings.
+*/
+inline vector<vector<double>> block_traffic(int lanes, double ego_s)
+{
+
+  vector<vector<double>> sensor_fusion;
+
+  int id = 0;
+  for (int l = 0; l < lanes; l++) {
+
+    for (int k = -1; k < 3; k++) {
+
+      double s  = ego_s + 35 * k + 7 * l;
+      double vx = 18 + 2 * l;
+      sensor_fusion.push_back({(double) id++, 0, 0, vx, 0, s, 2.0 + 4 * l});
+    }
+  }
+  return sensor_fusion;
+}
+
+/*
+ count telemetry frames of the ego in the middle lane at 44.8 mph,
+ spread along the track, each with 45 points of previous path 0.4 m
+ apart and 12 vehicles on 3 lanes, 30 m apart from 60 m behind it.
+*/
+template <typename XY>
+vector<Telemetry> make_frames(int count, XY xy)
+{
+
+  vector<Telemetry> frames(count);
+
+  for (int k = 0; k < count; k++) {
+
+    Telemetry & frame = frames[k];
+
+    frame.car_s     = 60 + k * (TRACK_S - 200) / count;
+    frame.car_d     = 6;
+    frame.car_speed = 44.8;
+
+    vector<double> p = xy(frame.car_s, frame.car_d);
+    vector<double> q = xy(frame.car_s + 1, frame.car_d);
+
+    frame.car_x   = p[0];
+    frame.car_y   = p[1];
+    frame.car_yaw = atan2(q[1] - p[1], q[0] - p[0]) * 180 / M_PI;
+
+    for (int i = 1; i <= 45; i++) {
+
+      vector<double> point = xy(frame.car_s + .4 * i, frame.car_d);
+
+      frame.previous_path_x.push_back(point[0]);
+      frame.previous_path_y.push_back(point[1]);
+    }
+
+    frame.end_path_s = frame.car_s + 18;
+    frame.end_path_d = frame.car_d;
+
+    double car_s = frame.car_s;
+
+    make_sensor_fusion(frame.sensor_fusion, 12, 3, [car_s](int id, int, double) { return car_s - 60 + 30 * id; }, xy);
+  }
+  return frames;
+}
+
+// the planner logs every decision to cout, keep it out of the
+// measurement; cout.clear() to print again
+inline void mute_planner_log() { cout.setstate(ios::badbit); }
+
+#endif
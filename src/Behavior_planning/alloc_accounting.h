@@ -0,0 +1,55 @@
+#ifndef ALLOC_ACCOUNTING_H
+#define ALLOC_ACCOUNTING_H
+#include <cstddef>
+#include "stage.h"
+
+using namespace std;
+
+/*
+ Heap use of a ledger, per Stage.
+*/
+struct AllocStats {
+
+  long allocations[num_stages] = {};
+
+  long bytes[num_stages]       = {};   //[B] allocated, freed or not
+
+  long live       = 0;                 //[B] allocated and not freed yet
+
+  long high_water = 0;                 //[B] highest live so far
+
+  long total_allocations() const;
+
+  long total_bytes() const;
+};
+
+/*
+ Opt in heap allocation accounting. The global operator new and
+ delete of alloc_hooks.cpp, linked in with -DALLOC_ACCOUNTING=ON,
+ count every allocation against the stage_tag of the calling thread,
+ in the process wide ledger 0 and in the ledger of the LedgerScope
+ the thread is in, one per session. Without the hooks every count
+ stays 0 and hooked is false.
+
+ open() resets the ledger of a new session. Memory a session leaves
+ behind and frees later counts against whoever holds the ledger
+ then, live never goes below 0.
+*/
+class AllocAccounting {
+public:
+
+  static bool hooked;
+
+  // ledger of a new session, counts reset
+  static int  open(int session);
+
+  // 0 for the whole process
+  static AllocStats stats(int ledger);
+
+  // called by the hooks, never allocate
+  static void allocated(int ledger, Stage stage, size_t bytes);
+
+  static void freed(int ledger, size_t bytes);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef BEHAVIOR_SCHEDULER_H
+#define BEHAVIOR_SCHEDULER_H
+#include <cstdint>
+#include "road.h"
+
+using namespace std;
+
+/*
+ Why the behavior layer ran on a message, NONE if it did not.
+*/
+enum class Trigger { NONE, FIRST, DEADLINE, OCCUPANCY };
+
+struct SchedulerStats {
+
+  long messages        = 0;
+
+  long behavior_cycles = 0;
+
+  long triggers[4]     = {0, 0, 0, 0};  // per Trigger
+
+  double behavior_cycles_per_message() const {
+
+    return messages > 0 ? (double) behavior_cycles / messages : 0;
+  }
+};
+
+/*
+ Decides on every telemetry message whether the behavior layer runs.
+ Path emission runs every message against the last decision either
+ way.
+
+ The behavior layer runs when period seconds of simulator time have
+ passed since its last cycle (the deadline, 0 runs it every message),
+ or, with on_events, as soon as the quantized occupancy around the ego
+ changes: a vehicle entering or leaving a bin_size bin of a lane
+ within [-behind, ahead) of the ego, or the ego changing lane. That
+ covers a leader change or a gap opening or closing by a bin. The
+ occupancy is one bitmask per lane, hashed every message from the
+ tracks in one pass.
+*/
+class BehaviorScheduler {
+public:
+
+  double period    = 0.5;       //[s] longest time between behavior cycles
+
+  bool   on_events = true;      // also run when the occupancy hash changes
+
+  double bin_size  = 10.0;      //[m]
+
+  double ahead     = 130.0;     //[m] occupancy window ahead of the ego
+
+  double behind    = 30.0;      //[m] and behind it, at most 32 bins in all
+
+  double max_s     = 6945.554;  //[m] s wraps back to 0 here
+
+  Trigger trigger  = Trigger::NONE; // of the last message
+
+  SchedulerStats stats;
+
+  /*
+   Called once per message after the tracks are updated, now being
+   the simulator time [s]. Returns true if the behavior layer has to
+   run on this message.
+  */
+  bool due(const Road & road, double now);
+
+  uint64_t occupancy_hash(const Road & road) const;
+
+private:
+
+  bool     ran_       = false;
+
+  double   last_run_  = 0;
+
+  uint64_t last_hash_ = 0;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+#include <vector>
+#include "prediction.h"
+#include "vehicle.h"
+
+using namespace std;
+
+struct CollisionStats {
+
+  long steps_checked     = 0;
+
+  long broadphase_pairs  = 0; // vehicles inside the s window of the ego
+
+  long narrowphase_tests = 0; // oriented box tests run
+};
+
+/*
+ Time indexed collision checks of ego trajectories against the
+ predicted traffic of a Prediction rollout, in Frenet space.
+
+ build() runs once per cycle: it sorts every time step of the rollout
+ by s (sweep and prune axis). A check then walks the ego trajectory
+ step by step, binary searches the vehicles whose s overlaps the ego,
+ drops those out of d reach and runs an oriented box test on the
+ rest. It stops at the first hit.
+*/
+class CollisionChecker {
+public:
+
+  float vehicle_length = 5.0;       //[m] box length, margin included
+
+  float vehicle_width  = 2.5;       //[m] box width, margin included
+
+  float max_s          = 6945.554;  //[m] s wraps back to 0 here
+
+  int   steps = 0;
+
+  float dt    = 0;
+
+  int   size  = 0;
+
+  // per time step rows of size entries sorted by s (wrapped into [0, max_s))
+  vector<float> s, d, cos_h, sin_h;
+
+  vector<int>   id;
+
+  void build(const Prediction & prediction);
+
+  Vehicle::collider check(const float * ego_s, const float * ego_d, int num_steps,
+                          CollisionStats * stats = nullptr) const;
+
+  Vehicle::collider check_lane_change(float ego_s, float ego_v, float d_from, float d_to,
+                                      float duration, CollisionStats * stats = nullptr) const;
+
+  bool step_collides(int step, float ego_s, float ego_d, float cos_e, float sin_e,
+                     CollisionStats * stats) const;
+
+private:
+
+  vector<int> order_;
+
+  float wrap_s(float s) const;
+};
+
+#endif
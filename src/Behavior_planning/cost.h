@@ -4,40 +4,286 @@
 
 using namespace std;
 
+constexpr float REACH_GOAL     = 0.1e5;
+constexpr float EFFICIENCY     = 2.0e2;
+constexpr float MAX_ACCELERATE = 1.5e6;
+constexpr float MAX_SPPED      = 1.5e6;
+constexpr float LANE_CHANGE    = 1.5e6;
+constexpr float OFF_ROAD       = 1.5e6;
+constexpr float CENTER_LANE    = 2.0e1;
+
+/*
+ Cost term weights in use, the constants above by default. Set at run
+ time from PlannerConfig, see Vehicle::cost_weights. They must stay
+ >= 0 for the bounds of bounded_sum() to hold.
+*/
+struct CostWeights {
+
+  float reach_goal     = REACH_GOAL;
+
+  float efficiency     = EFFICIENCY;
+
+  float max_accelerate = MAX_ACCELERATE;
+
+  float max_speed      = MAX_SPPED;
+
+  float lane_change    = LANE_CHANGE;
+
+  float off_road       = OFF_ROAD;
+
+  float center_lane    = CENTER_LANE;
+};
+
+/*
+ Helper data shared by all cost functions, see get_helper_data().
+*/
+struct TrajectoryFeatures {
+
+  int   intended_lane;
+
+  int   final_lane;
+
+  float distance_to_goal;
+};
+
+/*
+ Cost terms: a weight, the range of the unweighted cost and
+ a cost function, see cost.cpp. default_weight orders CostTerms,
+ weight() reads the weight in use.
+ To add a term declare it here and list it in CostTerms below.
+*/
+struct goal_distance_cost {
+
+  static constexpr float default_weight = REACH_GOAL;
+
+  static float weight(const CostWeights & w) { return w.reach_goal; }
+
+  static constexpr float lower_bound = -1.0;
+
+  static constexpr float upper_bound = 1.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+struct inefficiency_cost {
+
+  static constexpr float default_weight = EFFICIENCY;
+
+  static float weight(const CostWeights & w) { return w.efficiency; }
+
+  static constexpr float lower_bound = 0.0;
+
+  static constexpr float upper_bound = 2.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+struct max_accelerate_cost {
+
+  static constexpr float default_weight = MAX_ACCELERATE;
+
+  static float weight(const CostWeights & w) { return w.max_accelerate; }
+
+  static constexpr float lower_bound = 0.0;
+
+  static constexpr float upper_bound = 1.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+struct speed_limit_cost {
+
+  static constexpr float default_weight = MAX_SPPED;
+
+  static float weight(const CostWeights & w) { return w.max_speed; }
+
+  static constexpr float lower_bound = 0.0;
+
+  static constexpr float upper_bound = 1.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+struct safety_lane_change_cost {
+
+  static constexpr float default_weight = LANE_CHANGE;
+
+  static float weight(const CostWeights & w) { return w.lane_change; }
+
+  static constexpr float lower_bound = 0.0;
+
+  static constexpr float upper_bound = 1.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+struct stays_off_road_cost {
+
+  static constexpr float default_weight = OFF_ROAD;
+
+  static float weight(const CostWeights & w) { return w.off_road; }
+
+  static constexpr float lower_bound = 0.0;
+
+  static constexpr float upper_bound = 1.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+struct center_lane_cost {
+
+  static constexpr float default_weight = CENTER_LANE;
+
+  static float weight(const CostWeights & w) { return w.center_lane; }
+
+  static constexpr float lower_bound = 0.0;
+
+  static constexpr float upper_bound = 1.0;
+
+  static float cost(const Vehicle & vehicle,
+                    const Trajectory & trajectory,
+                    const map<int, vector<Vehicle>> & predictions,
+                    const TrajectoryFeatures & data);
+};
+
+/*
+ Counters of the branch-and-bound evaluation in choose_next_state().
+*/
+struct CostStats {
+
+  int candidates      = 0;
+
+  int pruned          = 0; // candidates dropped before all terms were evaluated
+
+  int terms_evaluated = 0;
+
+  int terms_total     = 0; // terms a full evaluation of every candidate would need
+};
+
+/*
+ Compile time list of cost terms summed by calculate_cost().
+ The weighted sum unrolls at compile time.
+
+ Terms are listed by decreasing default_weight * upper_bound so that
+ bounded_sum() sees the dominant terms first and can stop as soon as
+ the partial sum plus the smallest possible rest can not beat best_cost.
+*/
+template <typename... Terms>
+struct CostPipeline;
+
+template <>
+struct CostPipeline<> {
+
+  static constexpr int size() { return 0; }
+
+  static float min_sum(const CostWeights &) { return 0.0; }
+
+  static constexpr float dominance() { return 0.0; }
+
+  static constexpr bool ordered() { return true; }
+
+  static float sum(const Vehicle &, const Trajectory &,
+                   const map<int, vector<Vehicle>> &, const TrajectoryFeatures &,
+                   const CostWeights &) {
+
+    return 0.0;
+  }
+
+  static float bounded_sum(const Vehicle &, const Trajectory &,
+                           const map<int, vector<Vehicle>> &, const TrajectoryFeatures &,
+                           const CostWeights &, float partial, float, int &) {
+
+    return partial;
+  }
+};
+
+template <typename Term, typename... Rest>
+struct CostPipeline<Term, Rest...> {
+
+  static constexpr int size() { return 1 + CostPipeline<Rest...>::size(); }
+
+  // smallest weighted cost the terms can sum up to
+  static float min_sum(const CostWeights & weights) {
+
+    return Term::weight(weights) * Term::lower_bound + CostPipeline<Rest...>::min_sum(weights);
+  }
+
+  static constexpr float dominance() { return Term::default_weight * Term::upper_bound; }
+
+  static constexpr bool ordered() {
+
+    return dominance() >= CostPipeline<Rest...>::dominance()
+           && CostPipeline<Rest...>::ordered();
+  }
+
+  static float sum(const Vehicle & vehicle, const Trajectory & trajectory,
+                   const map<int, vector<Vehicle>> & predictions,
+                   const TrajectoryFeatures & data, const CostWeights & weights) {
+
+    return Term::weight(weights) * Term::cost(vehicle, trajectory, predictions, data)
+           + CostPipeline<Rest...>::sum(vehicle, trajectory, predictions, data, weights);
+  }
+
+  /*
+   Returns the full cost, or as soon as the cost is proven to be
+   >= best_cost, a lower bound of it (which is >= best_cost).
+  */
+  static float bounded_sum(const Vehicle & vehicle, const Trajectory & trajectory,
+                           const map<int, vector<Vehicle>> & predictions,
+                           const TrajectoryFeatures & data, const CostWeights & weights,
+                           float partial, float best_cost, int & terms_evaluated) {
+
+    partial += Term::weight(weights) * Term::cost(vehicle, trajectory, predictions, data);
+    terms_evaluated++;
+
+    float lower_bound = partial + CostPipeline<Rest...>::min_sum(weights);
+
+    if (lower_bound >= best_cost) return lower_bound;
+
+    return CostPipeline<Rest...>::bounded_sum(vehicle, trajectory, predictions, data, weights,
+                                              partial, best_cost, terms_evaluated);
+  }
+};
+
+//Add additional cost terms here.
+typedef CostPipeline<max_accelerate_cost,
+                     speed_limit_cost,
+                     safety_lane_change_cost,
+                     stays_off_road_cost,
+                     goal_distance_cost,
+                     inefficiency_cost,
+                     center_lane_cost> CostTerms;
+
+static_assert(CostTerms::ordered(),
+              "CostTerms must be listed by decreasing default_weight * upper_bound");
+
 float calculate_cost(const Vehicle & vehicle,
                      const map<int,
                      vector<Vehicle>> & predictions,
-                     const vector<Vehicle> & trajectory);
-
-float goal_distance_cost(const Vehicle & vehicle,
-                         const vector<Vehicle> & trajectory,
-                         const map<int, vector<Vehicle>> & predictions,
-                         map<string, float> & data);
-
-float inefficiency_cost(const Vehicle & vehicle,
-                        const vector<Vehicle> & trajectory,
-                        const map<int, vector<Vehicle>> & predictions,
-                        map<string, float> & data);
-
-float speed_limit_cost(const Vehicle & vehicle,
-                       const vector<Vehicle> & trajectory,
-                       const map<int, vector<Vehicle>> & predictions,
-                       map<string, float> & data);
-
-float stays_off_road_cost(const Vehicle & vehicle,
-                          const vector<Vehicle> & trajectory,
-                          const map<int, vector<Vehicle>> & predictions,
-                          map<string, float> & data);
-
-float center_lane_cost(const Vehicle & vehicle,
-                       const vector<Vehicle> & trajectory,
-                       const map<int, vector<Vehicle>> & predictions,
-                       map<string, float> & data);
-
-float max_accelerate_cost(const Vehicle & vehicle,
-                          const vector<Vehicle> & trajectory,
-                          const map<int, vector<Vehicle>> & predictions,
-                          map<string, float> & data);
+                     const Trajectory & trajectory);
+
+float calculate_cost_bounded(const Vehicle & vehicle,
+                             const map<int, vector<Vehicle>> & predictions,
+                             const Trajectory & trajectory,
+                             float best_cost, CostStats & stats);
 
 float lane_speed(const map<int, vector<Vehicle>> & predictions,
                  int lane);
@@ -51,8 +297,8 @@ bool vehicle_behind_detection(const map<int, vector<Vehicle>> & predictions,
 bool vehicle_beside_detection(const map<int, vector<Vehicle>> & predictions,
                               int lane, const Vehicle & vehicle);
 
-map<string, float> get_helper_data(const Vehicle & vehicle,
-                                   const vector<Vehicle> & trajectory,
+TrajectoryFeatures get_helper_data(const Vehicle & vehicle,
+                                   const Trajectory & trajectory,
                                    const map<int, vector<Vehicle>> & predictions);
 
 #endif
@@ -0,0 +1,139 @@
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+enum class Dispatch { FIFO, EDF };
+
+/*
+ Slack of completed planning jobs, deadline minus completion time.
+ Negative slack is a deadline miss.
+*/
+struct SlackHistogram {
+
+  static const int bins = 9;
+
+  static const double edges[bins - 1];  //[ms] upper edges, the first bin is the misses
+
+  long   counts[bins] = {0};
+
+  long   jobs         = 0;
+
+  long   misses       = 0;
+
+  double min_slack    = 0;    //[ms]
+
+  double sum_slack    = 0;    //[ms]
+
+  void add(double slack);
+
+  // slack at fraction q of the jobs, from the bin upper edges [ms]
+  double quantile(double q) const;
+};
+
+struct DeadlineStats {
+
+  long submitted  = 0;
+
+  long completed  = 0;
+
+  long superseded = 0;    // pending jobs replaced by newer telemetry of the session
+
+  SlackHistogram all;
+
+  map<int, SlackHistogram> sessions;
+};
+
+/*
+ Orders planning work of concurrent simulator sessions by urgency.
+
+ A session with prev_size points of its previous path left runs out of
+ path prev_size * point_period after its telemetry was received, that
+ is its deadline. Workers take the pending job with the earliest
+ deadline (EDF), or the earliest received one (FIFO, for comparison).
+ A session has at most one job pending, newer telemetry supersedes an
+ older pending one, and jobs of one session never run concurrently,
+ so the work may use the session state without locking.
+*/
+class DeadlineScheduler {
+public:
+
+  typedef chrono::steady_clock clock;
+
+  Dispatch dispatch      = Dispatch::EDF;
+
+  double point_period    = 20.0;   //[ms] the simulator drives one path point
+
+  /**
+  * Constructor, num_workers threads, 0 for the hardware threads.
+  */
+  explicit DeadlineScheduler(int num_workers = 0);
+
+  ~DeadlineScheduler();
+
+  DeadlineScheduler(const DeadlineScheduler &) = delete;
+
+  DeadlineScheduler & operator=(const DeadlineScheduler &) = delete;
+
+  int size() const { return (int) workers_.size(); }
+
+  clock::time_point deadline(clock::time_point received, int prev_size) const;
+
+  void submit(int session, int prev_size, clock::time_point received,
+              function<void()> work);
+
+  // blocks until no job is pending or running
+  void drain();
+
+  // a session gone for good: drops its pending job and its slack
+  // histogram, a running job finishes without being counted for it
+  void forget(int session);
+
+  // copy taken under the lock
+  DeadlineStats stats();
+
+  void reset_stats();
+
+private:
+
+  struct Job {
+
+    int               session;
+
+    clock::time_point received;
+
+    clock::time_point deadline;
+
+    function<void()>  work;
+  };
+
+  vector<thread> workers_;
+
+  mutex mutex_;
+
+  condition_variable work_cv_, idle_cv_;
+
+  vector<Job> pending_;
+
+  vector<int> running_;    // sessions with a job on a worker
+
+  vector<int> forgotten_;  // of running_, not to be counted in stats_.sessions
+
+  DeadlineStats stats_;
+
+  bool stop_ = false;
+
+  void worker();
+
+  // index of the next job to run, -1 if every pending session is running
+  int select() const;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef FEASIBILITY_H
+#define FEASIBILITY_H
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+enum class Violation { NONE, SPEED, LONGITUDINAL_ACCEL, LATERAL_ACCEL, JERK, CURVATURE };
+
+inline ostream & operator<<(ostream & os, Violation violation) {
+
+  static const char * const names[] = {"none", "speed", "longitudinal accel",
+                                       "lateral accel", "jerk", "curvature"};
+
+  return os << names[static_cast<int>(violation)];
+}
+
+struct FeasibilityStats {
+
+  int       points     = 0;
+
+  int       first      = -1;      // first violating point, the earliest of a batch, -1 if none
+
+  int       feasible   = 0;       // paths of the last check_batch() without a violation
+
+  Violation violation  = Violation::NONE; // at first, check() only
+
+  // peaks over the path
+  double    speed      = 0;       //[m/s]
+  double    lon_accel  = 0;       //[m/s^2] magnitude
+  double    lat_accel  = 0;       //[m/s^2]
+  double    jerk       = 0;       //[m/s^3]
+  double    curvature  = 0;       //[1/m]
+
+  double    elapsed_ms = 0;
+};
+
+/*
+ Dynamic feasibility of a path of points dt apart, against kinematic
+ bicycle model limits.
+
+ Like the simulator, quantities are taken over a window of points
+ (0.2 s by default): a 20 ms third difference turns millimeters of
+ spline refit at the previous path junction into hundreds of m/s^3.
+ With Q_k = P_(i - k window) and T the window duration, at point i:
+
+   speed      |Q_0 - Q_1| / T
+   lon accel  change of speed over the last two windows / T
+   curvature  Menger curvature of Q_2, Q_1, Q_0, zero below
+              min_segment, the heading is undefined there
+   lat accel  v^2 curvature, v the mean speed of the two windows
+   jerk       |Q_0 - 3 Q_1 + 3 Q_2 - Q_3| / T^3
+
+ The curvature limit is tan(max_steer) / wheelbase. Points without
+ the history a quantity needs are not checked for it. A violation is
+ reported at the latest point involved, so a path is feasible up to
+ first - 1.
+
+ check() takes one path: every quantity is a flat loop over the
+ points, and the first violation a min reduction, so the compiler
+ vectorizes it. check_batch() takes candidate paths stored time major
+ (point t of path p at t * paths + p) and vectorizes across paths.
+*/
+class FeasibilityChecker {
+public:
+
+  double dt                = 0.02;     //[s] point spacing
+
+  int    window            = 10;       // points, 1 for point to point
+
+  double max_speed         = 22.35;    //[m/s] 50 mph
+
+  double max_accel         = 10.0;     //[m/s^2]
+
+  double max_decel         = 10.0;     //[m/s^2]
+
+  double max_lateral_accel = 10.0;     //[m/s^2]
+
+  double max_jerk          = 10.0;     //[m/s^3]
+
+  double wheelbase         = 2.9;      //[m]
+
+  double max_steer         = 0.436;    //[rad] 25 deg
+
+  double min_segment       = 0.02;     //[m] 1 m/s at dt
+
+  FeasibilityStats stats;
+
+  double max_curvature() const;
+
+  // first violating point of the path, -1 if feasible
+  int check(const vector<double> & x, const vector<double> & y);
+
+  // first violating point of every path into first, -1 if feasible
+  void check_batch(const double * x, const double * y, int paths, int points, int * first);
+
+private:
+
+  // per point quantities of check(), index i is point i
+  vector<double> speed_, lon_accel_, curvature_, lat_accel_, jerk_;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef FRENET_SAMPLER_H
+#define FRENET_SAMPLER_H
+#include <memory>
+#include <vector>
+#include "prediction.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+struct SamplerStats {
+
+  int    candidates = 0;
+
+  int    collisions = 0;      // candidates hitting the predicted traffic
+
+  int    infeasible = 0;      // candidates over max_accel
+
+  int    threads    = 1;      // threads that scored the batch
+
+  double elapsed_ms = 0;      // build + score + select
+
+  double candidates_per_ms() const { return elapsed_ms > 0 ? candidates / elapsed_ms : 0; }
+};
+
+/*
+ Sampling based alternative to the FSM of Vehicle::choose_next_state.
+
+ End states are sampled on a grid of target lane (the ego lane and
+ its neighbors) x target speed x horizon T. Every candidate is a quartic in s (speed keeping, ends at
+ the target speed with no acceleration) and a quintic in d (ends in
+ the lane center with no lateral speed or acceleration), both starting
+ from the same ego state, and holds its end state after T.
+
+ Polynomial coefficients and cost terms are kept as structure of
+ arrays indexed by candidate. Scoring runs in blocks of candidates:
+ the ego positions of a block are evaluated one prediction time step
+ at a time and tested against every predicted vehicle with flat loops
+ over the block, which the compiler vectorizes. Blocks are spread over
+ a thread pool once the batch reaches parallel_threshold candidates.
+
+ Units are SI, speeds in m/s.
+*/
+class FrenetSampler {
+public:
+
+  // sampling grid
+  int   num_speeds    = 16;
+
+  float min_speed     = 0.0;       //[m/s]
+
+  float max_speed     = 21.9;      //[m/s] 49 mph
+
+  int   num_horizons  = 9;
+
+  float min_horizon   = 2.0;       //[s]
+
+  float max_horizon   = 6.0;       //[s]
+
+  int   num_lanes     = 3;
+
+  float lane_width    = 4.0;       //[m]
+
+  float max_s         = 6945.554;  //[m] s wraps back to 0 here
+
+  // collision footprint, margin included
+  float vehicle_length = 5.0;      //[m]
+
+  float vehicle_width  = 2.5;      //[m]
+
+  float max_accel      = 9.0;      //[m/s^2] longitudinal
+
+  // cost weights
+  float w_jerk        = 0.1;
+
+  float w_time        = 1.0;
+
+  float w_speed       = 1.0;
+
+  float w_lane        = 10.0;      // per lane away from goal_lane
+
+  float w_lane_change = 20.0;
+
+  float w_collision   = 1.0e6;
+
+  // parallel scoring
+  int   block_size         = 64;   // candidates per chunk
+
+  int   parallel_threshold = 512;  // smaller batches are scored on the caller
+
+  int   num_threads        = 0;    // pool workers, 0 for hardware threads - 1
+
+  // start state of the current batch
+  float s0 = 0, v0 = 0, a0 = 0, d0 = 0, d_dot0 = 0, d_ddot0 = 0;
+
+  int   lane0 = 0, goal_lane = 0;
+
+  // candidates, structure of arrays
+  int   size = 0;
+
+  vector<int>   lane;
+  vector<float> T, v1, d1;
+  vector<float> s_c3, s_c4;        // s(t) = s0 + v0 t + a0/2 t^2 + s_c3 t^3 + s_c4 t^4
+  vector<float> d_c3, d_c4, d_c5;  // d(t) = d0 + d_dot0 t + d_ddot0/2 t^2 + d_c3 t^3 + ...
+  vector<float> accel;             // peak |s''(t)| over [0, T]
+  vector<float> comfort, efficiency, preference, collision, cost;
+
+  int best = -1;
+
+  SamplerStats stats;
+
+  /*
+   Samples, scores and selects the best candidate, returns its index.
+  */
+  int plan(float s, float v, float a, float d, int goal_lane,
+           const Prediction & prediction);
+
+  void sample(float s, float v, float a, float d, int goal_lane);
+
+  void score(const Prediction & prediction);
+
+  int select();
+
+  float s_at(int i, float t) const;
+
+  float d_at(int i, float t) const;
+
+  // d of candidate i where it reaches s, d at T if it never does
+  float d_at_s(int i, float s) const;
+
+  // scores large batches on pool instead of a pool of its own
+  void share_pool(const shared_ptr<ThreadPool> & pool) { if (pool_ != pool) pool_ = pool; }
+
+private:
+
+  shared_ptr<ThreadPool> pool_; // shared by copies, created on the first large batch if not shared
+
+  vector<float> ego_s_, ego_d_, hit_; // per candidate scratch of the current time step
+
+  void score_block(int begin, int end, const Prediction & prediction);
+};
+
+#endif
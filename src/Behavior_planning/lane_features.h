@@ -0,0 +1,72 @@
+#ifndef LANE_FEATURES_H
+#define LANE_FEATURES_H
+#include <map>
+#include <vector>
+#include "vehicle.h"
+
+using namespace std;
+
+class OccupancyGrid;
+
+/*
+ What the behavior layer needs to know about one lane, relative to
+ the ego at the start of the cycle.
+*/
+struct LaneFeature {
+
+  int     leader_id      = -1;    // closest vehicle ahead, -1 if none
+
+  float   leader_gap     = 0;     //[m]
+
+  float   leader_speed   = 0;
+
+  Vehicle leader;
+
+  int     follower_id    = -1;    // closest vehicle behind, -1 if none
+
+  float   follower_gap   = 0;     //[m]
+
+  float   follower_speed = 0;
+
+  Vehicle follower;
+
+  bool    side_occupied   = false; // a vehicle within +-20 m of the ego
+
+  bool    behind_occupied = false; // a vehicle within 30 m behind the ego
+
+  float   flow_speed      = -1;    // mean speed ahead within flow_range, -1 if empty
+};
+
+/*
+ Per cycle cache of LaneFeature for every lane. update() fills it
+ with one pass over the predictions, every candidate state and cost
+ term then reads it instead of scanning the predictions again.
+*/
+class LaneFeatures {
+public:
+
+  float flow_range = 100; //[m]
+
+  vector<LaneFeature> lanes;
+
+  // counters of the current cycle. Every lookup used to be a scan
+  // over all predictions.
+  mutable long lookups = 0;
+
+  long scans           = 0;
+
+  long vehicles_per_scan = 0;
+
+  void update(const Vehicle & ego, const map<int, vector<Vehicle>> & predictions,
+              const OccupancyGrid * occupancy_grid);
+
+  const LaneFeature & lane(int lane) const;
+
+private:
+
+  LaneFeature off_road_;
+
+  vector<int> flow_count_; // vehicles summed into flow_speed, per lane
+};
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef LATTICE_H
+#define LATTICE_H
+#include <vector>
+#include "occupancy.h"
+
+using namespace std;
+
+/*
+ One lattice edge: constant acceleration from speed bin v0 to v1 over
+ steps time steps, keeping the lane or changing by lane_offset.
+*/
+struct Primitive {
+
+  unsigned char v0, v1;          // speed bins
+
+  signed char   lane_offset;     // -1 left, 0 keep, 1 right
+
+  unsigned char steps;           // duration in time steps
+
+  float         ds;              //[m] s advanced
+
+  float         cost;            // traffic independent part
+
+  int           footprint_begin; // cells in MotionLattice::footprints
+  int           footprint_end;
+};
+
+/*
+ Swept footprint of a primitive over a time window: the s range
+ relative to the start and the lane relative to the start lane.
+*/
+struct FootprintCell {
+
+  float       t0, t1;            //[s] from the primitive start
+
+  float       s0, s1;            //[m] from the start s
+
+  signed char lane_offset;
+};
+
+struct LatticeStats {
+
+  int    expansions  = 0;
+
+  int    pushes      = 0;
+
+  int    cell_checks = 0;        // footprint cells tested against the occupancy
+
+  bool   found       = false;    // a path covers the whole horizon
+
+  double elapsed_ms  = 0;
+};
+
+/*
+ State lattice over lane x speed bin x time step.
+
+ build() precomputes the primitive library once: lane keep over one
+ time step and lane changes over two, between neighbor speed bins
+ within the acceleration limit, with their swept footprints and
+ static costs. Primitives are stored in one flat array grouped by
+ start speed bin, so expanding a node walks a contiguous range.
+
+ plan() runs A* from the ego state to the horizon. A primitive is
+ taken only if every footprint cell is free in the per cycle
+ OccupancyGrid, nodes are merged by (time step, lane, speed bin,
+ s bin). Search stops after max_expansions, so latency is bounded;
+ the deepest path found so far is used then.
+
+ Units are SI, speeds in m/s.
+*/
+class MotionLattice {
+public:
+
+  int   num_lanes       = 3;
+
+  float lane_width      = 4.0;      //[m]
+
+  float vehicle_length  = 5.0;      //[m]
+
+  int   num_speeds      = 12;       // speed bins from 0 to max_speed, max_speed alone if 1
+
+  float max_speed       = 21.9;     //[m/s] 49 mph
+
+  float max_accel       = 5.0;      //[m/s^2]
+
+  float min_change_speed = 5.0;     //[m/s] slowest lane change
+
+  float step_dt         = 1.0;      //[s] lattice time step
+
+  int   num_steps       = 4;        // horizon in time steps
+
+  float footprint_dt    = 0.25;     //[s] footprint cell duration
+
+  float s_resolution    = 1.0;      //[m] node merge resolution
+
+  int   max_expansions  = 4000;
+
+  // cost weights
+  float w_accel         = 1.0;      // a^2 per second
+
+  float w_progress      = 1.0;      // per m short of max_speed
+
+  float w_lane_change   = 10.0;
+
+  float w_lane          = 2.0;      // per lane away from goal_lane, per second
+
+  vector<Primitive>     primitives;  // grouped by v0
+
+  vector<int>           first_primitive; // primitives of v0 are [first_primitive[v0], first_primitive[v0 + 1])
+
+  vector<FootprintCell> footprints;
+
+  vector<int>           path;        // primitives of the last plan, first to last
+
+  int                   primitives_per_node = 0; // most primitives of one start speed bin
+
+  LatticeStats stats;
+
+  void build();
+
+  float speed(int bin) const { return num_speeds > 1 ? max_speed * bin / (num_speeds - 1) : max_speed; }
+
+  /*
+   Returns the first primitive of the best path from (s, v, lane),
+   -1 if no primitive is collision free.
+  */
+  int plan(float s, float v, int lane, int goal_lane, const OccupancyGrid & occupancy_grid);
+
+private:
+
+  struct Node {
+
+    float         g;
+    float         s;
+    int           parent;
+    int           primitive;
+    unsigned char step, lane, v;
+  };
+
+  vector<Node> nodes_;
+
+  vector<pair<float, int>> open_;     // (f, node) min heap
+
+  vector<float> best_g_;              // per merged state
+
+  vector<int>   stamp_;               // plan() call that wrote best_g_
+
+  int  plan_id_ = 0;
+
+  int  s_bins_  = 0;
+
+  bool collision_free(const Primitive & primitive, float s, int lane, float t,
+                      const OccupancyGrid & occupancy_grid);
+
+  float heuristic(int lane, int goal_lane, int step) const;
+};
+
+#endif
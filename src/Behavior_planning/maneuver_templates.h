@@ -0,0 +1,93 @@
+#ifndef MANEUVER_TEMPLATES_H
+#define MANEUVER_TEMPLATES_H
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+/*
+ Lane change templates, built once at startup.
+
+ A template is the minimum jerk lateral transition
+ p(tau) = 10 tau^3 - 15 tau^4 + 6 tau^5 over a maneuver duration,
+ sampled every dt, for one speed bin. Per step it keeps p, the
+ fraction of the lane offset done, and the along track advance as a
+ fraction of v dt, so the path speed stays v while the vehicle also
+ moves sideways. Each template is checked against the
+ FeasibilityChecker limits for a one lane change at its bin speed.
+
+ Templates are stored contiguously, template (speed bin b, duration k)
+ at id = b * num_durations + k and its steps at id * max_steps. select()
+ picks the shortest feasible duration of the nearest speed bin, so a
+ lane change costs a lookup per path point.
+*/
+class ManeuverTemplates {
+public:
+
+  float min_speed     = 5.0;     //[m/s]
+
+  float max_speed     = 22.35;   //[m/s]
+
+  int   speed_bins    = 16;
+
+  float min_duration  = 1.5;     //[s]
+
+  float max_duration  = 4.0;     //[s]
+
+  float duration_step = 0.25;    //[s]
+
+  float dt            = 0.02;    //[s] path point spacing
+
+  float lane_width    = 4.0;     //[m]
+
+  int   num_durations = 0;
+
+  int   max_steps     = 0;
+
+  // one entry per template
+  vector<int>   steps;
+  vector<char>  feasible;
+
+  // max_steps entries per template, past its steps p = 1 and advance = 1
+  vector<float> lateral;         // p, 0 to 1
+  vector<float> advance;         // along track step / (v dt)
+
+  void build();
+
+  float speed(int id) const;
+
+  float duration(int id) const;
+
+  // template for a lane change at speed v [m/s]
+  int select(float v) const;
+
+  // fraction of the lane offset done at step, 1 past the end
+  float lateral_at(int id, int step) const;
+
+  float advance_at(int id, int step) const;
+};
+
+/*
+ A lane change in progress: the template it follows and the template
+ step of the next path point to emit.
+*/
+struct LaneChange {
+
+  int    id     = -1;      // template, -1 when none is in progress
+
+  int    step   = 0;
+
+  double from_d = 0;       //[m]
+
+  double to_d   = 0;       //[m]
+
+  bool active() const { return id >= 0; }
+
+  // d of the path point at step
+  double d(const ManeuverTemplates & templates, int step) const {
+
+    return from_d + (to_d - from_d) * templates.lateral_at(id, max(0, step));
+  }
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+#include <cstdint>
+#include <vector>
+#include "prediction.h"
+
+using namespace std;
+
+/*
+ Lanes x s bins x time steps occupancy of the predicted traffic.
+
+ Every (time step, lane) row is a bitset over s bins covering the whole
+ track, so the track seam is just the wrap of the bin index. A vehicle
+ sets the bins under its footprint, in its lane and also in the
+ neighbor lane when it straddles the lane line.
+
+ update() only clears the words set by the previous cycle. lane_free()
+ ORs the masked words of the queried s range over the queried steps.
+*/
+class OccupancyGrid {
+public:
+
+  float bin_size       = 2.0;       //[m]
+
+  float vehicle_length = 5.0;       //[m] footprint along s
+
+  float lane_width     = 4.0;       //[m]
+
+  float straddle       = 1.0;       //[m] distance from the lane center to also occupy the neighbor lane
+
+  float max_s          = 6945.554;  //[m] s wraps back to 0 here
+
+  int   num_lanes      = 3;
+
+  int   num_bins       = 0;
+
+  int   words_per_row  = 0;
+
+  int   steps          = 0;
+
+  float dt             = 0;
+
+  vector<uint64_t> words; // (step * num_lanes + lane) * words_per_row + word
+
+  void update(const Prediction & prediction);
+
+  bool lane_free(int lane, float s0, float s1, float t0, float t1) const;
+
+  bool lane_free(int lane, float s0, float s1) const { return lane_free(lane, s0, s1, 0, 0); }
+
+private:
+
+  vector<int> dirty_; // words set since the last update
+
+  void resize(int steps, float dt);
+
+  void set_bins(int row, int b0, int b1);
+
+  bool any_bins(int row, int b0, int b1) const;
+
+  void bin_range(float s0, float s1, int & b0, int & b1) const;
+};
+
+#endif
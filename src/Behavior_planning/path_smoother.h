@@ -0,0 +1,103 @@
+#ifndef PATH_SMOOTHER_H
+#define PATH_SMOOTHER_H
+#include <vector>
+#include "../Eigen-3.3/Eigen/SparseCore"
+#include "../Eigen-3.3/Eigen/SparseCholesky"
+
+using namespace std;
+
+struct SmootherStats {
+
+  int    nodes      = 0;
+
+  int    iterations = 0;     // factorizations, one per active set pass
+
+  int    active     = 0;     // nodes held at a corridor bound
+
+  bool   analyzed   = false; // the symbolic factorization was redone
+
+  double elapsed_ms = 0;
+};
+
+/*
+ Reference path smoother.
+
+ The raw path nodes R_i = (ref_x, ref_y), one every spacing meters of
+ s, come from getXY and carry the kinks of the piecewise linear map.
+ Each node may move by an offset l_i along its unit normal n_i, within
+ [lower_i, upper_i] (the lane corridor), and the offsets minimize
+
+   w_ref |l|^2 + w_d2 sum_k (n_k . (D2 P)_k)^2 / h^4
+               + w_d3 sum_k (n_k . (D3 P)_k)^2 / h^6,   P = R + n l
+
+ with D2, D3 the second and third difference operators, n_k the normal
+ at the middle of difference k and h the spacing, i.e. the lateral
+ curvature and its change along the smoothed path. Only the lateral
+ part of a difference is penalized: getXY leaves gaps along the road
+ at the map corners, which no lateral offset can close.
+
+ The Hessian is banded with a half bandwidth of 3 and has the same
+ sparsity for every path of n nodes, so its symbolic LDL^T
+ factorization is done once and each cycle only refactors the values.
+
+ Bounds are handled with an active set: offsets outside the corridor
+ get a stiff penalty toward the bound and the system is refactored,
+ until no new node leaves the corridor or max_iterations is reached.
+*/
+class PathSmoother {
+public:
+
+  double spacing        = 0.6;    //[m] node spacing along s
+
+  double corridor       = 1.0;    //[m] offset bound either side of the lane center
+
+  double w_ref          = 1.0;    // offset from the raw node
+
+  double w_d2           = 1e4;    // second differences, ~ curvature
+
+  double w_d3           = 1e4;    // third differences, ~ curvature rate
+
+  double w_bound        = 1e7;    // penalty of an active bound
+
+  int    max_iterations = 4;
+
+  // inputs, filled by the caller, one entry per node
+  vector<double> ref_x, ref_y;
+
+  vector<double> normal_x, normal_y; // unit, toward increasing d
+
+  vector<double> lower, upper;       //[m] offset bounds
+
+  // outputs
+  vector<double> offset;
+
+  vector<double> x, y;
+
+  SmootherStats stats;
+
+  void smooth();
+
+private:
+
+  typedef Eigen::SparseMatrix<double> Matrix;
+
+  int n_ = 0;
+
+  Matrix H_;                       // lower band, column j holds rows j to j + 3
+
+  Eigen::SimplicialLDLT<Matrix, Eigen::Lower, Eigen::NaturalOrdering<int>> solver_;
+
+  Eigen::VectorXd rhs_, l_;
+
+  vector<double> difference_;      // difference part of the H_ values
+  vector<double> gradient_;        // difference part of the gradient at l = 0
+
+  vector<double> penalty_;         // w_bound at active nodes
+  vector<double> bound_;           // bound an active node is held at
+
+  void accumulate(int k, int order, double w, const double * d);
+
+  void analyze(int n);
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+#include <cstdint>
+#include "stage.h"
+
+using namespace std;
+
+enum class PerfEvent { CYCLES, INSTRUCTIONS, L1D_MISSES, LLC_MISSES, BRANCH_MISSES };
+
+const int num_perf_events = 5;
+
+const char * perf_event_name(PerfEvent event);
+
+/*
+ What the threads of a ledger spent in each Stage: wall clock time and
+ the hardware events, user space only. Events the kernel does not
+ count (no PMU in a VM, perf_event_paranoid, no such event on the CPU)
+ stay 0 with counted false.
+
+ Few instructions per cycle with many misses per 1000 instructions
+ means the stage waits on memory, high IPC with few misses that it is
+ compute bound.
+*/
+struct PerfStats {
+
+  long time_ns[num_stages] = {};                     //[ns]
+
+  long counts[num_stages][num_perf_events] = {};
+
+  bool counted[num_perf_events] = {};
+
+  long count(Stage stage, PerfEvent event) const;
+
+  // instructions per cycle, 0 without cycles
+  double ipc(Stage stage) const;
+
+  // event per 1000 instructions, 0 without instructions
+  double per_kilo_instruction(Stage stage, PerfEvent event) const;
+};
+
+/*
+ Per thread hardware counters by stage. enable() opens a
+ perf_event_open group on the calling thread, cycles leading
+ instructions, L1D read misses, LLC read misses and branch misses, and
+ makes it the thread's StageObserver: every StageScope and LedgerScope
+ reads the whole group with one read() and charges the counts since
+ the last read to the stage and ledger still tagged, in ledger 0 for
+ the process and the session's ledger. What a thread does outside any
+ LedgerScope and StageScope, waiting for work, is not charged. Counts
+ of a group the kernel multiplexes are scaled by enabled over running
+ time.
+
+ Each read is a system call, about a microsecond, a dozen per cycle.
+ Leave it off unless measuring.
+*/
+class PerfCounters : public StageObserver {
+public:
+
+  // starts counting the calling thread's stages, once per thread; false
+  // when no hardware event can be counted, the wall clock still is
+  static bool enable();
+
+  // resets the ledger of a new session
+  static void open(int session);
+
+  // 0 for the whole process
+  static PerfStats stats(int ledger);
+
+  void sample() override;
+
+  ~PerfCounters();
+
+private:
+
+  PerfCounters();
+
+  int      group_ = -1;                  // leader, -1 if nothing opened
+
+  int      fds_[num_perf_events];
+
+  int      slots_[num_perf_events];      // in the group read, -1 not counted
+
+  int      opened_ = 0;
+
+  uint64_t last_[num_perf_events] = {};
+
+  uint64_t last_enabled_ = 0, last_running_ = 0;
+
+  long     last_ns_;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef PLANNER_CONFIG_H
+#define PLANNER_CONFIG_H
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "cost.h"
+
+using namespace std;
+
+/*
+ Tunable planner parameters. A published PlannerConfig is immutable,
+ an update publishes a new one, see ConfigStore.
+*/
+struct PlannerConfig {
+
+  long        version          = 0;     // set by ConfigStore::publish
+
+  int         speed_limit      = 49;    //[mph] impacts default behavior for most states
+
+  vector<int> lane_speeds      = {49, 49, 49};  //[mph] one per lane
+
+  int         max_accel        = 10;    //[m/s^2] ego accelerates within +-max_accel
+
+  vector<int> goal             = {6945, 1};     // s [m] and lane of the goal
+
+  int         preferred_buffer = 20;    //[m] impacts "keep lane" behavior
+
+  CostWeights weights;
+
+  //configuration data:  target speed, speed limit, num_lanes,
+  //                     goal_s, goal_lane, max_acceleration
+  vector<int> ego_config() const;
+
+  // empty if the configuration is usable, the first problem otherwise
+  string validate() const;
+
+  string to_json() const;
+
+  // fields in body override those of base, returns an error message or ""
+  static string from_json(const string & body, const PlannerConfig & base, PlannerConfig & config);
+};
+
+/*
+ Holds the current PlannerConfig behind an atomic pointer, RCU style.
+
+ Readers take a ReadGuard: they announce the epoch they started in and
+ load the pointer, no locks. publish() swaps in a new snapshot, bumps
+ the epoch and frees retired snapshots once no reader announced an
+ epoch up to their retirement. Publishers serialize on a mutex,
+ readers never wait for them. Reader slots are per thread, at most
+ max_readers live threads read, a slot is freed when its thread exits,
+ and a thread holds one ReadGuard at a time.
+*/
+class ConfigStore {
+public:
+
+  static const int max_readers = 64;
+
+  explicit ConfigStore(const PlannerConfig & initial);
+
+  ~ConfigStore();
+
+  ConfigStore(const ConfigStore &) = delete;
+
+  ConfigStore & operator=(const ConfigStore &) = delete;
+
+  class ReadGuard {
+  public:
+
+    explicit ReadGuard(const ConfigStore & store);
+
+    ~ReadGuard();
+
+    ReadGuard(const ReadGuard &) = delete;
+
+    ReadGuard & operator=(const ReadGuard &) = delete;
+
+    const PlannerConfig & operator*() const { return *config_; }
+
+    const PlannerConfig * operator->() const { return config_; }
+
+  private:
+
+    atomic<uint64_t> *    slot_;
+
+    const PlannerConfig * config_;
+  };
+
+  // validates config, returns "" once it is current or why it was rejected
+  string publish(const PlannerConfig & config);
+
+  long version() const;
+
+  int retired() const;  // snapshots waiting for readers, freed by a later publish
+
+private:
+
+  atomic<const PlannerConfig *> current_;
+
+  atomic<uint64_t> epoch_;
+
+  mutable atomic<uint64_t> readers_[max_readers]; // epoch a reader started in, 0 idle
+
+  mutable mutex publish_mutex_;
+
+  vector<pair<uint64_t, const PlannerConfig *>> retired_;  // retirement epoch, snapshot
+
+  atomic<uint64_t> * slot() const;
+
+  void reclaim();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PREDICTION_H
+#define PREDICTION_H
+#include <vector>
+
+using namespace std;
+
+/*
+ Rollout of all tracked vehicles over a time horizon.
+
+ Inputs and outputs are kept as structure of arrays. Outputs are
+ stored time major: vehicle i at step k is at index k * stride + i,
+ so every time step is one contiguous (padded) row which collision
+ checks can scan with plain vector loops.
+
+ s is not wrapped at the end of the track.
+*/
+class Prediction {
+public:
+
+  enum Model { CONSTANT_VELOCITY, CONSTANT_ACCELERATION };
+
+  float lane_width        = 4.0;  //[m]
+
+  int   num_lanes         = 3;
+
+  float lane_change_d_dot = 0.5;  //[m/s] lateral speed taken as lane change intent
+
+  float horizon;                  //[s]
+
+  float dt;                       //[s]
+
+  int   steps;                    // time steps, step 0 is now
+
+  int   size   = 0;               // number of vehicles
+
+  int   stride = 0;               // size rounded up to a multiple of 8
+
+  // inputs, one entry per vehicle
+  vector<int>   id;
+  vector<float> s0, d0, v0, a0, d_dot0;
+
+  // outputs, steps * stride entries
+  vector<float> s, d, v;
+
+  /**
+  * Constructor
+  */
+  Prediction(float horizon = 5.0, float dt = 0.1);
+
+  void configure(float horizon, float dt);
+
+  void clear();
+
+  void add(int id, float s, float d, float v, float a, float d_dot);
+
+  void rollout(Model model = CONSTANT_ACCELERATION);
+
+  float time_at(int step) const { return step * dt; }
+
+  const float * s_row(int step) const { return &s[step * stride]; }
+
+  const float * d_row(int step) const { return &d[step * stride]; }
+
+  const float * v_row(int step) const { return &v[step * stride]; }
+
+  int lane_at(int step, int i) const { return (int) (d[step * stride + i] / lane_width); }
+
+private:
+
+  // per vehicle rollout parameters, reused across cycles
+  vector<float> a_, t_stop_, d_dot_, d_min_, d_max_;
+
+};
+
+#endif
@@ -1,3 +1,5 @@
+#ifndef ROAD_H
+#define ROAD_H
 #include <iostream>
 #include <random>
 #include <sstream>
@@ -9,23 +11,94 @@
 #include <string>
 #include <iterator>
 #include "vehicle.h"
+#include "cost.h"
+#include "planner_config.h"
+#include "prediction.h"
+#include "collision.h"
+#include "tracker.h"
+#include "occupancy.h"
+#include "lane_features.h"
+#include "frenet_sampler.h"
+#include "speed_planner.h"
+#include "lattice.h"
 
 using namespace std;
 
+/*
+ Persistent state of one sensor fusion id, see Road::tracks.
+*/
+struct Track {
+
+  bool    active     = false; // the slot holds a live track
+
+  int     generation = 0;     // bumped every time the slot starts a new track
+
+  int     last_seen  = -1;    // frame of the last sensor fusion update
+
+  // Kalman filtered state, see Road::tracker
+
+  double  s;                  //[m] projected to the end of the previous path
+
+  double  d;                  //[m]
+
+  double  v;                  //[m/s]
+
+  double  a;                  //[m/s^2]
+
+  double  d_dot;              //[m/s]
+
+  Vehicle vehicle;            // view used by the behavior layer
+};
+
+/*
+ Decision layer picking the ego lane and target speed every cycle.
+*/
+enum class Planner { FSM, SAMPLING, LATTICE };
+
 class Road {
 public:
 
-  int ego_key = -1;
-
   int num_lanes;
 
   vector<int> lane_speeds;
 
   int speed_limit;
 
-  map<int, Vehicle> vehicles;
+  Vehicle ego;
+
+  // traffic, indexed by sensor fusion id. Slots are updated in place
+  // and a track expires after max_missed_frames frames without update.
+  vector<Track> tracks;
+
+  int max_missed_frames = 5;
+
+  // sensor fusion ids outside [0, max_tracks) are ignored
+  int max_tracks = 1024;
 
-  int vehicles_added = 0;
+  Tracker tracker; // one filter per track slot
+
+  int frame = 0;
+
+  // 1 second step predictions of every active track, reused across cycles
+  map<int, vector<Vehicle>> predictions;
+
+  CostStats cost_stats; // cost evaluation counters of the last behavior cycle
+
+  CostWeights cost_weights; // of the planner configuration, see configure
+
+  Prediction prediction; // long horizon rollout of the traffic, refreshed every cycle
+
+  CollisionChecker collision_checker; // built from prediction every cycle
+
+  OccupancyGrid occupancy_grid; // updated from prediction every cycle
+
+  LaneFeatures lane_features; // computed from predictions every cycle
+
+  FrenetSampler sampler; // used by sampling_planning instead of the FSM
+
+  SpeedPlanner speed_planner; // speed profile along the ego lane, see speed_planning
+
+  MotionLattice lattice; // primitives built once in the constructor, see lattice_planning
 
   /**
   * Constructor
@@ -48,8 +121,19 @@ public:
 
   void add_ego(int lane_num, int s, double vel, vector<int> config_data);
 
-  void add_vehicles_surrounding(vector<vector<double>> sensor_fusion, int prev_size);
+  void configure(const PlannerConfig & config);
+
+  void add_vehicles_surrounding(const vector<vector<double>> & sensor_fusion, int prev_size,
+                                double elapsed = 0);
 
   void behavior_planning();
 
+  void sampling_planning(double speed, double d);
+
+  void speed_planning(double speed);
+
+  void lattice_planning(double speed);
+
 };
+
+#endif
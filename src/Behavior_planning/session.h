@@ -0,0 +1,168 @@
+#ifndef SESSION_H
+#define SESSION_H
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "road.h"
+#include "alloc_accounting.h"
+#include "behavior_scheduler.h"
+#include "feasibility.h"
+#include "maneuver_templates.h"
+#include "path_smoother.h"
+#include "planner_config.h"
+#include "telemetry.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+struct PlanningContext;
+
+/*
+ Planner state of one simulator connection. Everything a planning
+ cycle changes lives here, so sessions can be planned on different
+ workers at the same time. DeadlineScheduler runs at most one cycle
+ of a session at a time.
+*/
+struct Session {
+
+  int    id;
+
+  Road   road;
+
+  int    lane      = 1;      // start in lane 1, the goal lane
+
+  double ref_vel   = 0.0;    //[mph] reference velocity to target, max 49.5
+
+  int    sent_size = 0;      // path points sent with the last control message
+
+  double sim_time  = 0.0;    //[s] simulator time, advanced by the path points driven
+
+  LaneChange         lane_change;
+
+  BehaviorScheduler  scheduler;
+
+  PathSmoother       smoother;
+
+  FeasibilityChecker feasibility;
+
+  long   config_version;     // PlannerConfig the road is configured with
+
+  bool   connected = true;   // cleared on disconnection, event loop only
+
+  string token;              // presented by a reconnecting client, see CheckpointStore
+
+  string checkpoint_buffer;  // reused by every checkpoint
+
+  int    ledger;             // its row in AllocAccounting and PerfCounters
+
+  /**
+  * Constructor, ego at s = 0 in lane with configuration config.
+  */
+  Session(int id, const PlannerConfig & config)
+    : id(id), road(config.speed_limit, config.lane_speeds), config_version(config.version),
+      ledger(session_ledger(id)) {
+
+    road.add_ego(lane, 0, ref_vel, config.ego_config());
+    road.configure(config);
+  }
+
+  /*
+   Compact binary snapshot of what a reconnecting client needs to go
+   on where it left: the ego FSM state, lane and speed controller, the
+   lane change in progress, the track table and its Kalman filters.
+   Scheduler, smoother and checker state is rebuilt within a cycle.
+  */
+  void checkpoint(string & blob) const;
+
+  // false, and the session untouched, if blob is not a checkpoint of
+  // this build or out of range for this session. A lane change in
+  // progress needs the templates it follows.
+  bool restore(const string & blob, const ManeuverTemplates * templates = nullptr);
+
+  /*
+   One planning cycle on telemetry, whichever transport it came in on:
+   configuration, tracking, behavior, the path and the checkpoint, each
+   tagged with its Stage and charged to the session's ledger. Returns
+   the path to send.
+  */
+  Control plan(const Telemetry & telemetry, const PlanningContext & context);
+};
+
+/*
+ Latest checkpoint per session token, kept in memory and, with a
+ directory, written out as <directory>/<token>.ckpt on persist() so a
+ restarted planner can resume sessions too. Checkpoints older than ttl
+ are dropped by the next get() or persist(). Thread safe, workers put()
+ at the end of every cycle.
+*/
+class CheckpointStore {
+public:
+
+  double ttl = 600.0;        //[s]
+
+  string directory;          // empty for memory only
+
+  static string new_token();
+
+  // blob is swapped with the previous checkpoint of token
+  void put(const string & token, string & blob);
+
+  // latest checkpoint of token, from memory or the directory
+  bool get(const string & token, string & blob);
+
+  bool persist(const string & token);
+
+  int size();
+
+private:
+
+  typedef chrono::steady_clock clock;
+
+  mutex mutex_;
+
+  unordered_map<string, pair<clock::time_point, string>> checkpoints_;
+
+  string path(const string & token) const;
+
+  void expire();
+};
+
+/*
+ What planning cycles share across sessions: the map, the
+ configuration, where checkpoints go and the planner switches of
+ main.cpp.
+*/
+struct PlanningContext {
+
+  const ConfigStore &      config_store;
+
+  const vector<double> &   maps_s;
+
+  const vector<double> &   maps_x;
+
+  const vector<double> &   maps_y;
+
+  CheckpointStore *        checkpoints   = nullptr;   // nullptr to keep no checkpoints
+
+  const ManeuverTemplates * templates    = nullptr;   // lane changes follow them if set
+
+  shared_ptr<ThreadPool>   pool;                      // for every session, nullptr for a pool per session
+
+  Planner                  planner       = Planner::FSM;
+
+  bool                     speed_planner = false;
+
+  bool                     smooth_path   = false;
+
+  bool                     multi_rate    = false;
+
+  bool                     perf_counters = false;
+
+  PlanningContext(const ConfigStore & config_store, const vector<double> & maps_s,
+                  const vector<double> & maps_x, const vector<double> & maps_y)
+    : config_store(config_store), maps_s(maps_s), maps_x(maps_x), maps_y(maps_y) {}
+};
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "telemetry.h"
+
+using namespace std;
+
+/*
+ Fixed layout records exchanged through shared memory, no pointers,
+ the same in both processes.
+*/
+struct TelemetryRecord {
+
+  static const int max_path     = 128;
+
+  static const int max_vehicles = 64;
+
+  uint64_t seq;
+
+  double   car_x, car_y, car_s, car_d, car_yaw, car_speed;
+
+  double   end_path_s, end_path_d;
+
+  int32_t  prev_size;
+
+  int32_t  num_vehicles;
+
+  double   previous_path_x[max_path];
+
+  double   previous_path_y[max_path];
+
+  double   sensor_fusion[max_vehicles][7];
+};
+
+struct ControlRecord {
+
+  static const int max_path = 128;
+
+  uint64_t seq;           // of the telemetry planned on
+
+  int32_t  size;
+
+  double   next_x[max_path];
+
+  double   next_y[max_path];
+};
+
+// paths longer than max_path and traffic beyond max_vehicles are cut
+void to_record(const Telemetry & telemetry, uint64_t seq, TelemetryRecord & record);
+
+void from_record(const TelemetryRecord & record, Telemetry & telemetry);
+
+void to_record(const Control & control, uint64_t seq, ControlRecord & record);
+
+void from_record(const ControlRecord & record, Control & control);
+
+/*
+ Single producer single consumer ring of N records (N a power of 2)
+ living in shared memory. head and tail only ever grow, slot i % N.
+ The consumer spins briefly, then sleeps on a futex on head (polls
+ where there is no futex). The producer wakes it only when it
+ announced it sleeps, so a busy consumer costs the producer no
+ system call.
+*/
+template <typename T, uint32_t N>
+struct SpscRing {
+
+  static_assert((N & (N - 1)) == 0, "N must be a power of 2");
+
+  alignas(64) atomic<uint32_t> head;      // next slot written, producer only
+
+  alignas(64) atomic<uint32_t> tail;      // next slot read, consumer only
+
+  alignas(64) atomic<uint32_t> sleeping;  // the consumer waits on head
+
+  alignas(64) T slots[N];
+
+  void init() { head.store(0); tail.store(0); sleeping.store(0); }
+
+  // false when full
+  bool push(const T & record);
+
+  // false after timeout_ms without a record, < 0 waits forever
+  bool pop(T & record, int timeout_ms);
+};
+
+/*
+ Shared memory transport between the planner and a simulator (or a
+ stand in) on the same host: telemetry records one way, control
+ records the other, through a POSIX shared memory region of two
+ SpscRings. The planner create()s the region, the simulator side
+ attach()es to it. send() and receive() are overloaded on the record
+ type, so each side uses the pair for its direction.
+*/
+class ShmTransport {
+public:
+
+  static const uint32_t ring_size = 8;
+
+  ShmTransport() {}
+
+  ~ShmTransport();
+
+  ShmTransport(const ShmTransport &) = delete;
+
+  ShmTransport & operator=(const ShmTransport &) = delete;
+
+  // name as for shm_open, "/path_planning"
+  bool create(const string & name);
+
+  bool attach(const string & name);
+
+  bool send(const TelemetryRecord & record);
+
+  bool send(const ControlRecord & record);
+
+  bool receive(TelemetryRecord & record, int timeout_ms);
+
+  bool receive(ControlRecord & record, int timeout_ms);
+
+private:
+
+  struct Region {
+
+    uint32_t magic;
+
+    uint32_t size;
+
+    SpscRing<TelemetryRecord, ring_size> telemetry;
+
+    SpscRing<ControlRecord, ring_size>   control;
+  };
+
+  Region * region_ = nullptr;
+
+  string   name_;
+
+  bool     owner_  = false;   // unlinks the region when done
+
+  bool map(const string & name, bool create);
+};
+
+#endif
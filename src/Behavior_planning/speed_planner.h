@@ -0,0 +1,124 @@
+#ifndef SPEED_PLANNER_H
+#define SPEED_PLANNER_H
+#include <memory>
+#include <vector>
+#include "prediction.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+struct SpeedPlannerStats {
+
+  int    columns    = 0;
+
+  int    rows       = 0;
+
+  long   edges      = 0;     // transitions tried
+
+  bool   feasible   = false; // false if every path hit a blocked cell or a limit
+
+  int    threads    = 1;
+
+  double elapsed_ms = 0;
+};
+
+/*
+ Dynamic programming speed optimizer on an s-t graph.
+
+ Time columns t_k = k dt over the horizon, station rows s_i = i ds
+ ahead of the ego. Cells a predicted vehicle of the target lane
+ occupies (plus min_gap behind it) are blocked. Node (k, i) keeps the
+ cost of the best path reaching it and the speed and acceleration of
+ its last edge, so an edge from (k-1, i-delta) gets its speed from
+ delta and its acceleration and jerk from the parent node. Edges over
+ max_speed, max_accel or max_decel are dropped, the rest are costed
+ against the reference speed, acceleration and jerk. Keeping a single
+ speed per node makes this the usual approximate DP of s-t planners.
+
+ A column is relaxed one delta at a time with a flat loop over rows
+ taking the running minimum, which the compiler vectorizes. Row
+ ranges of a column are spread over a thread pool when the grid is
+ large.
+
+ Units are SI, speeds in m/s.
+*/
+class SpeedPlanner {
+public:
+
+  float horizon        = 4.0;       //[s]
+
+  float dt             = 0.25;      //[s] column spacing
+
+  float ds             = 0.1;       //[m] row spacing, speeds are multiples of ds / dt
+
+  float max_speed      = 21.9;      //[m/s] 49 mph
+
+  float max_accel      = 5.0;       //[m/s^2]
+
+  float max_decel      = 8.0;       //[m/s^2]
+
+  float min_gap        = 10.0;      //[m] kept behind a vehicle ahead, its length included
+
+  float vehicle_length = 5.0;       //[m]
+
+  float lane_width     = 4.0;       //[m]
+
+  float straddle       = 1.0;       //[m] see OccupancyGrid::straddle
+
+  float max_s          = 6945.554;  //[m] s wraps back to 0 here
+
+  // cost weights
+  float w_speed        = 1.0;       // (v_ref - v)^2
+
+  float w_accel        = 0.5;       // a^2
+
+  float w_jerk         = 0.05;      // j^2
+
+  // parallel relaxation
+  int   parallel_threshold = 1024;  // rows, smaller columns are relaxed on the caller
+
+  int   num_threads        = 0;     // pool workers, 0 for hardware threads - 1
+
+  int   columns = 0, rows = 0;
+
+  // node arrays, columns * rows, column major
+  vector<float>         cost, speed, accel;
+
+  vector<int>           parent;     // delta of the best incoming edge
+
+  vector<unsigned char> blocked;
+
+  // best path, one entry per column
+  vector<float> path_s, path_v;
+
+  SpeedPlannerStats stats;
+
+  /*
+   Plans from s (track s), speed v and acceleration a in the lane
+   toward v_ref. Returns false if no path avoids every blocked cell,
+   path_v then brakes at max_decel.
+  */
+  bool plan(float s, float v, float a, int lane, float v_ref, const Prediction & prediction);
+
+  // speed along the best path at time t, linear between columns
+  float speed_at(float t) const;
+
+  // relaxes large columns on pool instead of a pool of its own
+  void share_pool(const shared_ptr<ThreadPool> & pool) { if (pool_ != pool) pool_ = pool; }
+
+private:
+
+  shared_ptr<ThreadPool> pool_;
+
+  float s0_ = 0, v_ref_ = 0;
+
+  void resize();
+
+  void block(float s, int lane, const Prediction & prediction);
+
+  void relax_rows(int k, int begin, int end);
+
+  void backtrack(int k, int i);
+};
+
+#endif
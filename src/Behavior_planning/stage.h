@@ -0,0 +1,101 @@
+#ifndef STAGE_H
+#define STAGE_H
+
+using namespace std;
+
+/*
+ Stages of a planning cycle. Instrumentation attributes what a thread
+ does to the stage its innermost StageScope set, OTHER outside of
+ any. Work handed to pool threads (sampler, speed planner) counts as
+ OTHER on those threads.
+*/
+enum class Stage { OTHER, PARSE, TRACKING, PREDICTION, CANDIDATES, COST, SPLINE, SERIALIZE };
+
+const int num_stages = 8;
+
+const char * stage_name(Stage stage);
+
+/*
+ Instrumentation tables (AllocAccounting, PerfCounters) keep one row
+ per session, its ledger, and row 0 for the whole process. A session
+ id maps to 1 + id % max_ledgers.
+*/
+const int max_ledgers = 256;
+
+inline int session_ledger(int session) { return 1 + session % max_ledgers; }
+
+extern thread_local Stage stage_tag;    // of the calling thread
+
+extern thread_local int   ledger_tag;   // 0 outside any LedgerScope
+
+/*
+ Told before the calling thread changes stage or ledger, so it can
+ charge what it measured so far to the ones still tagged.
+*/
+class StageObserver {
+public:
+
+  virtual ~StageObserver() {}
+
+  virtual void sample() = 0;
+};
+
+extern thread_local StageObserver * stage_observer;   // nullptr for none
+
+/*
+ Tags the calling thread with stage until the scope ends, then
+ restores the enclosing stage, so scopes nest.
+*/
+class StageScope {
+public:
+
+  explicit StageScope(Stage stage) : previous_(stage_tag) {
+
+    if (stage_observer) stage_observer->sample();
+    stage_tag = stage;
+  }
+
+  ~StageScope() {
+
+    if (stage_observer) stage_observer->sample();
+    stage_tag = previous_;
+  }
+
+  StageScope(const StageScope &) = delete;
+
+  StageScope & operator=(const StageScope &) = delete;
+
+private:
+
+  Stage previous_;
+};
+
+/*
+ Charges the calling thread's work to ledger until the scope ends,
+ e.g. the session whose cycle runs on it.
+*/
+class LedgerScope {
+public:
+
+  explicit LedgerScope(int ledger) : previous_(ledger_tag) {
+
+    if (stage_observer) stage_observer->sample();
+    ledger_tag = ledger;
+  }
+
+  ~LedgerScope() {
+
+    if (stage_observer) stage_observer->sample();
+    ledger_tag = previous_;
+  }
+
+  LedgerScope(const LedgerScope &) = delete;
+
+  LedgerScope & operator=(const LedgerScope &) = delete;
+
+private:
+
+  int previous_;
+};
+
+#endif
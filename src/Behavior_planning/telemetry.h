@@ -0,0 +1,46 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <vector>
+
+using namespace std;
+
+/*
+ One telemetry message of the simulator, the input of a planning
+ cycle, whichever transport it came in on.
+*/
+struct Telemetry {
+
+  // main car's localization data
+  double car_x     = 0;    //[m]
+
+  double car_y     = 0;    //[m]
+
+  double car_s     = 0;    //[m]
+
+  double car_d     = 0;    //[m]
+
+  double car_yaw   = 0;    //[deg]
+
+  double car_speed = 0;    //[mph]
+
+  // previous path data given to the planner, the points not driven yet
+  vector<double> previous_path_x, previous_path_y;
+
+  // previous path's end s and d values
+  double end_path_s = 0;   //[m]
+
+  double end_path_d = 0;   //[m]
+
+  // [id, x, y, vx, vy, s, d] of every other car on the same side of the road
+  vector<vector<double>> sensor_fusion;
+};
+
+/*
+ Path the planner sends back, 20 ms between points.
+*/
+struct Control {
+
+  vector<double> next_x, next_y;
+};
+
+#endif
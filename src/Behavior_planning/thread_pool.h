@@ -0,0 +1,72 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+ Fixed set of worker threads for data parallel loops.
+
+ parallel_for() hands out [begin, end) chunks of grain items from an
+ atomic counter, the calling thread takes chunks too, and returns once
+ every chunk is done. Nothing is allocated per call as long as the
+ task fits in the small buffer of std::function (a lambda capturing
+ a pointer or two).
+
+ One pool can serve several threads, e.g. the planning workers of
+ every session: a caller finding it busy with another loop runs its
+ own on itself rather than waiting or adding threads.
+*/
+class ThreadPool {
+public:
+
+  /**
+  * Constructor, num_threads workers besides the caller,
+  * 0 for one less than the hardware threads.
+  */
+  explicit ThreadPool(int num_threads = 0);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  int size() const { return (int) workers_.size() + 1; } // caller included
+
+  // threads the loop ran on, 1 for the caller alone
+  int parallel_for(int n, int grain, const function<void(int, int)> & task);
+
+private:
+
+  vector<thread> workers_;
+
+  mutex mutex_;
+
+  mutex call_mutex_;   // held by the caller of the current loop
+
+  condition_variable work_cv_, done_cv_;
+
+  const function<void(int, int)> * task_ = nullptr;
+
+  int n_ = 0, grain_ = 1;
+
+  atomic<int> next_;
+
+  int  busy_ = 0;    // workers still on the current job
+
+  long job_  = 0;    // incremented for every parallel_for
+
+  bool stop_ = false;
+
+  void worker();
+
+  void run_chunks();
+};
+
+#endif
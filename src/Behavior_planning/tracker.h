@@ -0,0 +1,80 @@
+#ifndef TRACKER_H
+#define TRACKER_H
+#include <vector>
+#include "../Eigen-3.3/Eigen/Core"
+#include "../Eigen-3.3/Eigen/StdVector"
+
+using namespace std;
+
+/*
+ Constant acceleration Kalman filters of the sensor fusion tracks in
+ Frenet coordinates, one per track slot (see Road::tracks).
+
+ state       x = [s, s_dot, s_ddot, d, d_dot, d_ddot]
+ measurement z = [s, v, d], v being the measured speed |(vx, vy)|
+
+ Measurements of a frame are staged with measure(), update() then
+ runs predict + correct over all slots in one loop. All matrices are
+ fixed size, nothing is allocated once every slot exists.
+*/
+class Tracker {
+public:
+
+  typedef Eigen::Matrix<double, 6, 1> StateVector;
+  typedef Eigen::Matrix<double, 6, 6> StateMatrix;
+  typedef Eigen::Matrix<double, 3, 1> MeasurementVector;
+  typedef Eigen::Matrix<double, 3, 6> MeasurementMatrix;
+  typedef Eigen::Matrix<double, 3, 3> MeasurementCovariance;
+
+  struct Filter {
+
+    StateVector x;
+
+    StateMatrix P;
+
+    MeasurementVector z;
+
+    bool active     = false;
+
+    bool measured   = false; // z holds a measurement of this frame
+
+    bool fresh      = false; // started this frame, x is already current
+
+    int  generation = -1;    // track generation the filter was started for
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  double max_s    = 6945.554; //[m] s wraps back to 0 here
+
+  double jerk_s   = 2.0;      //[m/s^3] process noise, longitudinal jerk
+
+  double jerk_d   = 1.0;      //[m/s^3] process noise, lateral jerk
+
+  double sigma_s  = 0.5;      //[m] measurement noise
+
+  double sigma_v  = 0.3;      //[m/s]
+
+  double sigma_d  = 0.2;      //[m]
+
+  vector<Filter, Eigen::aligned_allocator<Filter>> filters; // indexed by track slot
+
+  void measure(int slot, int generation, double s, double v, double d);
+
+  void drop(int slot);
+
+  void update(double dt);
+
+  double s(int slot)      const { return filters[slot].x(0); }
+  double s_dot(int slot)  const { return filters[slot].x(1); }
+  double s_ddot(int slot) const { return filters[slot].x(2); }
+  double d(int slot)      const { return filters[slot].x(3); }
+  double d_dot(int slot)  const { return filters[slot].x(4); }
+  double d_ddot(int slot) const { return filters[slot].x(5); }
+
+private:
+
+  void start(Filter & filter, int generation, const MeasurementVector & z);
+};
+
+#endif
@@ -2,18 +2,108 @@
 #define VEHICLE_H
 #include <iostream>
 #include <random>
+#include <array>
 #include <vector>
 #include <map>
 #include <string>
+#include <type_traits>
 
 using namespace std;
 
+/*
+ Behavior FSM states.
+ CS  : constant speed (non ego vehicles)
+ KL  : keep lane
+ PLCL: prepare lane change left,  LCL: lane change left
+ PLCR: prepare lane change right, LCR: lane change right
+*/
+enum class State : unsigned char { CS, KL, PLCL, PLCR, LCL, LCR };
+
+/*
+ Transition table of the FSM, indexed by State.
+ lane_direction is the lane offset the state is heading to,
+ successors are the reachable next states before the lane check
+ done in Vehicle::successor_states().
+*/
+struct StateInfo {
+
+  const char *name;
+
+  int   lane_direction;
+
+  int   num_successors;
+
+  State successors[3];
+};
+
+constexpr StateInfo STATE_TABLE[] = {
+  /* CS   */ {"CS",    0, 1, {State::KL}},
+  /* KL   */ {"KL",    0, 3, {State::KL, State::PLCL, State::PLCR}},
+  /* PLCL */ {"PLCL", -1, 3, {State::KL, State::PLCL, State::LCL}},
+  /* PLCR */ {"PLCR",  1, 3, {State::KL, State::PLCR, State::LCR}},
+  /* LCL  */ {"LCL",  -1, 1, {State::KL}},
+  /* LCR  */ {"LCR",   1, 1, {State::KL}},
+};
+
+constexpr const StateInfo & state_info(State state) {
+
+  return STATE_TABLE[static_cast<int>(state)];
+}
+
+constexpr int lane_direction(State state) {
+
+  return state_info(state).lane_direction;
+}
+
+constexpr const char * state_name(State state) {
+
+  return state_info(state).name;
+}
+
+static_assert(sizeof(STATE_TABLE) / sizeof(STATE_TABLE[0])
+              == static_cast<int>(State::LCR) + 1, "STATE_TABLE must cover every State");
+static_assert(lane_direction(State::PLCL) == -1 && lane_direction(State::LCL) == -1,
+              "left maneuvers move to lane - 1");
+static_assert(lane_direction(State::PLCR) ==  1 && lane_direction(State::LCR) ==  1,
+              "right maneuvers move to lane + 1");
+
+inline ostream & operator<<(ostream & os, State state) {
+
+  return os << state_name(state);
+}
+
+/*
+ Fixed capacity list of states returned by Vehicle::successor_states().
+*/
+struct StateSet {
+
+  State states[3];
+
+  int   count = 0;
+
+  void push_back(State state) { states[count++] = state; }
+
+  int size() const { return count; }
+
+  const State * begin() const { return states; }
+
+  const State * end() const { return states + count; }
+};
+
+class Trajectory;
+
+struct CostStats;
+
+struct CostWeights;
+
+class CollisionChecker;
+
+class OccupancyGrid;
+class LaneFeatures;
+
 class Vehicle {
 public:
 
-  map<string, int> lane_direction
-  = {{"PLCL", -1}, {"LCL",  -1}, {"LCR", 1}, {"PLCR", 1}};
-
   struct collider{
 
     bool collision ; // is there a collision?
@@ -25,6 +115,24 @@ public:
 
   int preferred_buffer = 20; //[m] impacts "keep lane" behavior.
 
+  float lane_change_time = 2.0; //[s] duration checked for lane change collisions
+
+  // collision checks of lane changes against the predicted traffic,
+  // set by Road every cycle. Without it only the current s is checked.
+  const CollisionChecker * collision_checker = nullptr;
+
+  // lane occupancy of the predicted traffic, set by Road every cycle.
+  // Without it gap checks scan the predictions.
+  const OccupancyGrid * occupancy_grid = nullptr;
+
+  // per lane leader, follower and gap features, set by Road every
+  // cycle. Without it every lookup scans the predictions.
+  const LaneFeatures * lane_features = nullptr;
+
+  // cost term weights of the planner configuration, set by Road every
+  // cycle. Without it the compile time defaults of cost.h apply.
+  const CostWeights * cost_weights = nullptr;
+
   int lane;
 
   int s;
@@ -45,49 +153,73 @@ public:
 
   int goal_s;
 
-  string state;
+  State state;
 
   /**
   * Constructor
   */
   Vehicle();
-  Vehicle(int lane, float s, float v, float a, string state="CS");
+  Vehicle(int lane, float s, float v, float a, State state=State::CS);
 
-  /**
-  * Destructor
-  */
-  virtual ~Vehicle();
+  Trajectory choose_next_state(const map<int, vector<Vehicle>> & predictions,
+                               CostStats * stats = nullptr);
 
-  vector<Vehicle> choose_next_state(map<int, vector<Vehicle>> predictions);
+  StateSet successor_states();
 
-  vector<string> successor_states();
+  Trajectory generate_trajectory(State state, const map<int, vector<Vehicle>> & predictions);
 
-  vector<Vehicle> generate_trajectory(string state, map<int, vector<Vehicle>> predictions);
+  array<float, 3> get_kinematics(const map<int, vector<Vehicle>> & predictions, int lane);
 
-  vector<float> get_kinematics(map<int, vector<Vehicle>> predictions, int lane);
+  Trajectory constant_speed_trajectory();
 
-  vector<Vehicle> constant_speed_trajectory();
+  Trajectory keep_lane_trajectory(const map<int, vector<Vehicle>> & predictions);
 
-  vector<Vehicle> keep_lane_trajectory(map<int, vector<Vehicle>> predictions);
+  Trajectory lane_change_trajectory(State state, const map<int, vector<Vehicle>> & predictions);
 
-  vector<Vehicle> lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions);
-
-  vector<Vehicle> prep_lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions);
+  Trajectory prep_lane_change_trajectory(State state, const map<int, vector<Vehicle>> & predictions);
 
   void increment(int dt);
 
   float position_at(int t);
 
-  bool get_vehicle_behind(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle);
+  bool get_vehicle_behind(const map<int, vector<Vehicle>> & predictions, int lane, Vehicle & rVehicle);
 
-  bool get_vehicle_ahead(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle);
+  bool get_vehicle_ahead(const map<int, vector<Vehicle>> & predictions, int lane, Vehicle & rVehicle);
 
   vector<Vehicle> generate_predictions(int horizon=3);
 
-  void realize_next_state(vector<Vehicle> trajectory);
+  void generate_predictions(vector<Vehicle> & predictions, int horizon=3);
+
+  void realize_next_state(const Trajectory & trajectory);
 
   void configure(vector<int> road_data);
 
 };
 
+/*
+ Rough trajectory of a behavior state: the vehicle now and one
+ timestep in the future. An empty trajectory means the state
+ can not be realized.
+*/
+class Trajectory {
+public:
+
+  Vehicle points[2];
+
+  int     count = 0;
+
+  void push_back(const Vehicle & vehicle) { points[count++] = vehicle; }
+
+  int size() const { return count; }
+
+  const Vehicle & operator[](int i) const { return points[i]; }
+
+  Vehicle & operator[](int i) { return points[i]; }
+};
+
+static_assert(is_trivially_copyable<Vehicle>::value,
+              "Vehicle is copied into every trajectory and prediction");
+static_assert(is_trivially_copyable<Trajectory>::value,
+              "Trajectory is returned by value for every candidate state");
+
 #endif
@@ -0,0 +1,104 @@
+#include <atomic>
+#include "Behavior_planning/alloc_accounting.h"
+
+bool AllocAccounting::hooked = false;
+
+struct Ledger {
+
+  atomic<long> allocations[num_stages];
+
+  atomic<long> bytes[num_stages];
+
+  atomic<long> live;
+
+  atomic<long> high_water;
+};
+
+// zero initialized before any allocation, no constructor to wait for
+static Ledger ledgers[max_ledgers + 1];
+
+long AllocStats::total_allocations() const {
+
+  long total = 0;
+
+  for (int i = 0; i < num_stages; i++) total += allocations[i];
+
+  return total;
+}
+
+long AllocStats::total_bytes() const {
+
+  long total = 0;
+
+  for (int i = 0; i < num_stages; i++) total += bytes[i];
+
+  return total;
+}
+
+int AllocAccounting::open(int session) {
+
+  Ledger & l = ledgers[session_ledger(session)];
+
+  for (int i = 0; i < num_stages; i++) {
+
+    l.allocations[i].store(0, memory_order_relaxed);
+    l.bytes[i].store(0, memory_order_relaxed);
+  }
+
+  l.live.store(0, memory_order_relaxed);
+  l.high_water.store(0, memory_order_relaxed);
+
+  return session_ledger(session);
+}
+
+AllocStats AllocAccounting::stats(int ledger) {
+
+  const Ledger & l = ledgers[ledger];
+
+  AllocStats stats;
+
+  for (int i = 0; i < num_stages; i++) {
+
+    stats.allocations[i] = l.allocations[i].load(memory_order_relaxed);
+    stats.bytes[i]       = l.bytes[i].load(memory_order_relaxed);
+  }
+
+  stats.live       = l.live.load(memory_order_relaxed);
+  stats.high_water = l.high_water.load(memory_order_relaxed);
+
+  return stats;
+}
+
+static void count(Ledger & l, Stage stage, long bytes) {
+
+  int s = static_cast<int>(stage);
+
+  l.allocations[s].fetch_add(1, memory_order_relaxed);
+  l.bytes[s].fetch_add(bytes, memory_order_relaxed);
+
+  long live = l.live.fetch_add(bytes, memory_order_relaxed) + bytes;
+  long high = l.high_water.load(memory_order_relaxed);
+
+  while (live > high && !l.high_water.compare_exchange_weak(high, live, memory_order_relaxed)) {}
+}
+
+static void uncount(Ledger & l, long bytes) {
+
+  long live = l.live.load(memory_order_relaxed);
+
+  while (!l.live.compare_exchange_weak(live, live > bytes ? live - bytes : 0, memory_order_relaxed)) {}
+}
+
+void AllocAccounting::allocated(int ledger, Stage stage, size_t bytes) {
+
+  count(ledgers[0], stage, bytes);
+
+  if (ledger > 0) count(ledgers[ledger], stage, bytes);
+}
+
+void AllocAccounting::freed(int ledger, size_t bytes) {
+
+  uncount(ledgers[0], bytes);
+
+  if (ledger > 0) uncount(ledgers[ledger], bytes);
+}
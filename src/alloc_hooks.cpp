@@ -0,0 +1,73 @@
+#include <cstdlib>
+#include <new>
+#include "Behavior_planning/alloc_accounting.h"
+
+/*
+ Replaceable global operator new and delete for AllocAccounting. Each
+ block carries a header with its size and ledger, so delete uncounts
+ it from the ledger it was counted in whichever thread frees it.
+ The header keeps the alignment of malloc.
+*/
+struct alignas(alignof(max_align_t)) BlockHeader {
+
+  size_t size;
+
+  int    ledger;
+};
+
+static const bool hooked = (AllocAccounting::hooked = true);
+
+static void * allocate(size_t size) {
+
+  BlockHeader * header = (BlockHeader *) malloc(sizeof(BlockHeader) + size);
+
+  if (!header) return nullptr;
+
+  header->size   = size;
+  header->ledger = ledger_tag;
+
+  AllocAccounting::allocated(header->ledger, stage_tag, size);
+
+  return header + 1;
+}
+
+static void release(void * p) {
+
+  if (!p) return;
+
+  BlockHeader * header = (BlockHeader *) p - 1;
+
+  AllocAccounting::freed(header->ledger, header->size);
+
+  free(header);
+}
+
+void * operator new(size_t size) {
+
+  void * p = allocate(size);
+  if (!p) throw bad_alloc();
+  return p;
+}
+
+void * operator new[](size_t size) {
+
+  void * p = allocate(size);
+  if (!p) throw bad_alloc();
+  return p;
+}
+
+void * operator new(size_t size, const nothrow_t &) noexcept { return allocate(size); }
+
+void * operator new[](size_t size, const nothrow_t &) noexcept { return allocate(size); }
+
+void operator delete(void * p) noexcept { release(p); }
+
+void operator delete[](void * p) noexcept { release(p); }
+
+void operator delete(void * p, size_t) noexcept { release(p); }
+
+void operator delete[](void * p, size_t) noexcept { release(p); }
+
+void operator delete(void * p, const nothrow_t &) noexcept { release(p); }
+
+void operator delete[](void * p, const nothrow_t &) noexcept { release(p); }
@@ -0,0 +1,71 @@
+#include "Behavior_planning/behavior_scheduler.h"
+
+/*
+   FNV-1a over the ego lane and one bin bitmask per lane.
+*/
+uint64_t BehaviorScheduler::occupancy_hash(const Road & road) const {
+
+  uint32_t masks[8] = {0};
+
+  int    lanes  = min(road.num_lanes, 8);
+  int    bins   = min(32, (int) ((ahead + behind) / bin_size));
+  double half_s = 0.5 * max_s;
+
+  for (const Track & track : road.tracks) {
+
+    if (!track.active) continue;
+
+    double rel = track.s - road.ego.s;
+
+    rel = rel >  half_s ? rel - max_s : rel;
+    rel = rel < -half_s ? rel + max_s : rel;
+
+    int bin  = (int) floor((rel + behind) / bin_size);
+    int lane = (int) floor(track.d / 4);
+
+    if (bin < 0 || bin >= bins || lane < 0 || lane >= lanes) continue;
+
+    masks[lane] |= 1u << bin;
+  }
+
+  uint64_t hash = 14695981039346656037ull;
+
+  auto mix = [&hash](uint32_t word) {
+
+    for (int b = 0; b < 4; b++) {
+
+      hash ^= (word >> (8 * b)) & 0xff;
+      hash *= 1099511628211ull;
+    }
+  };
+
+  mix((uint32_t) road.ego.lane);
+
+  for (int l = 0; l < lanes; l++) mix(masks[l]);
+
+  return hash;
+}
+
+bool BehaviorScheduler::due(const Road & road, double now) {
+
+  stats.messages++;
+
+  uint64_t hash = on_events ? occupancy_hash(road) : 0;
+
+  if      (!ran_)                                   trigger = Trigger::FIRST;
+  else if (now - last_run_ >= period)               trigger = Trigger::DEADLINE;
+  else if (on_events && hash != last_hash_)         trigger = Trigger::OCCUPANCY;
+  else                                              trigger = Trigger::NONE;
+
+  stats.triggers[static_cast<int>(trigger)]++;
+
+  if (trigger == Trigger::NONE) return false;
+
+  ran_       = true;
+  last_run_  = now;
+  last_hash_ = hash;
+
+  stats.behavior_cycles++;
+
+  return true;
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include "Behavior_planning/collision.h"
+
+float CollisionChecker::wrap_s(float s) const {
+
+  s = fmod(s, max_s);
+  return (s < 0) ? s + max_s : s;
+}
+
+/*
+   Sorts every time step of the rollout by s. Step k starts from the
+   order of step k-1, which is almost sorted already, so the insertion
+   sort is close to a single pass.
+*/
+void CollisionChecker::build(const Prediction & prediction) {
+
+  this->steps = prediction.steps;
+  this->dt    = prediction.dt;
+  this->size  = prediction.size;
+
+  int n = this->size;
+
+  s.resize(steps * n);
+  d.resize(steps * n);
+  cos_h.resize(steps * n);
+  sin_h.resize(steps * n);
+  id.resize(steps * n);
+  order_.resize(n);
+
+  for (int i = 0; i < n; i++) order_[i] = i;
+
+  for (int k = 0; k < steps; k++) {
+
+    const float * p_s = prediction.s_row(k);
+    float * row       = &s[k * n];
+
+    for (int j = 0; j < n; j++) row[j] = wrap_s(p_s[order_[j]]);
+
+    for (int j = 1; j < n; j++) {
+
+      float key_j   = row[j];
+      int   order_j = order_[j];
+      int   m       = j - 1;
+
+      while (m >= 0 && row[m] > key_j) {
+
+        row[m + 1]    = row[m];
+        order_[m + 1] = order_[m];
+        m--;
+      }
+      row[m + 1]    = key_j;
+      order_[m + 1] = order_j;
+    }
+
+    // heading from the displacement to the neighbor time step
+    int k0 = (k + 1 < steps) ? k : max(k - 1, 0);
+    int k1 = k0 + 1;
+
+    for (int j = 0; j < n; j++) {
+
+      int   i = order_[j];
+      float h_s = 1, h_d = 0;
+
+      d[k * n + j]  = prediction.d_row(k)[i];
+      id[k * n + j] = prediction.id[i];
+
+      if (k1 < steps) {
+
+        h_s = prediction.s_row(k1)[i] - prediction.s_row(k0)[i];
+        h_d = prediction.d_row(k1)[i] - prediction.d_row(k0)[i];
+      }
+
+      float norm = sqrt(h_s * h_s + h_d * h_d);
+
+      if (norm < 1e-3) { h_s = 1; h_d = 0; norm = 1; }
+
+      cos_h[k * n + j] = h_s / norm;
+      sin_h[k * n + j] = h_d / norm;
+    }
+  }
+}
+
+/*
+   Oriented box test of the ego against the traffic of one time step.
+*/
+bool CollisionChecker::step_collides(int step, float ego_s, float ego_d,
+                                     float cos_e, float sin_e,
+                                     CollisionStats * stats) const {
+
+  int n = this->size;
+
+  if (n == 0) return false;
+
+  const float * row_s = &s[step * n];
+  const float * row_d = &d[step * n];
+  const float * row_c = &cos_h[step * n];
+  const float * row_n = &sin_h[step * n];
+
+  float half_l = 0.5 * vehicle_length;
+  float half_w = 0.5 * vehicle_width;
+  float reach  = 2 * sqrt(half_l * half_l + half_w * half_w);
+
+  ego_s = wrap_s(ego_s);
+
+  // s window of the ego, split in two when it crosses the track seam
+  float lo[2] = {ego_s - reach, 0};
+  float hi[2] = {ego_s + reach, -1};
+
+  if (lo[0] < 0) { lo[1] = lo[0] + max_s; hi[1] = max_s; lo[0] = 0; }
+  else if (hi[0] >= max_s) { lo[1] = 0; hi[1] = hi[0] - max_s; hi[0] = max_s; }
+
+  for (int w = 0; w < 2; w++) {
+
+    if (hi[w] < lo[w]) continue;
+
+    int j = lower_bound(row_s, row_s + n, lo[w]) - row_s;
+
+    for (; j < n && row_s[j] <= hi[w]; j++) {
+
+      if (stats) stats->broadphase_pairs++;
+
+      float delta_d = row_d[j] - ego_d;
+
+      if (fabs(delta_d) > reach) continue;
+
+      float delta_s = row_s[j] - ego_s;
+
+      if (delta_s >  0.5 * max_s) delta_s -= max_s;
+      if (delta_s < -0.5 * max_s) delta_s += max_s;
+
+      if (stats) stats->narrowphase_tests++;
+
+      // separating axis test over the two axes of both boxes
+      float axes[4][2] = {{cos_e, sin_e}, {-sin_e, cos_e},
+                          {row_c[j], row_n[j]}, {-row_n[j], row_c[j]}};
+
+      bool separated = false;
+
+      for (int a = 0; a < 4 && !separated; a++) {
+
+        float ax = axes[a][0], ay = axes[a][1];
+
+        float r_e = half_l * fabs(cos_e * ax + sin_e * ay)
+                  + half_w * fabs(-sin_e * ax + cos_e * ay);
+        float r_t = half_l * fabs(row_c[j] * ax + row_n[j] * ay)
+                  + half_w * fabs(-row_n[j] * ax + row_c[j] * ay);
+
+        separated = fabs(delta_s * ax + delta_d * ay) > r_e + r_t;
+      }
+
+      if (!separated) return true;
+    }
+  }
+
+  return false;
+}
+
+/*
+   Checks an ego trajectory sampled at the rollout time steps.
+   Returns the first time step in collision.
+*/
+Vehicle::collider CollisionChecker::check(const float * ego_s, const float * ego_d,
+                                          int num_steps, CollisionStats * stats) const {
+
+  Vehicle::collider collider = {false, -1};
+
+  num_steps = min(num_steps, this->steps);
+
+  for (int k = 0; k < num_steps; k++) {
+
+    int   k0 = (k + 1 < num_steps) ? k : max(k - 1, 0);
+    int   k1 = min(k0 + 1, num_steps - 1);
+    float h_s = ego_s[k1] - ego_s[k0];
+    float h_d = ego_d[k1] - ego_d[k0];
+    float norm = sqrt(h_s * h_s + h_d * h_d);
+
+    if (norm < 1e-3) { h_s = 1; h_d = 0; norm = 1; }
+
+    if (stats) stats->steps_checked++;
+
+    if (step_collides(k, ego_s[k], ego_d[k], h_s / norm, h_d / norm, stats)) {
+
+      collider.collision = true;
+      collider.time      = k;
+      break;
+    }
+  }
+
+  return collider;
+}
+
+/*
+   Checks a lane change from d_from to d_to over duration [s] at constant
+   speed ego_v [m/s], with a smooth (cubic) lateral profile. Only the
+   maneuver itself is checked, following traffic afterwards is up to
+   keep lane.
+*/
+Vehicle::collider CollisionChecker::check_lane_change(float ego_s, float ego_v,
+                                                      float d_from, float d_to,
+                                                      float duration,
+                                                      CollisionStats * stats) const {
+
+  Vehicle::collider collider = {false, -1};
+
+  for (int k = 0; k < this->steps && k * this->dt <= duration; k++) {
+
+    float t = k * this->dt;
+    float u = min(t / duration, 1.0f);
+
+    float s_k   = ego_s + ego_v * t;
+    float d_k   = d_from + (d_to - d_from) * u * u * (3 - 2 * u);
+    float d_dot = (u < 1) ? (d_to - d_from) * 6 * u * (1 - u) / duration : 0;
+
+    float norm = sqrt(ego_v * ego_v + d_dot * d_dot);
+    float cos_e = (norm > 1e-3) ? ego_v / norm : 1;
+    float sin_e = (norm > 1e-3) ? d_dot / norm : 0;
+
+    if (stats) stats->steps_checked++;
+
+    if (step_collides(k, s_k, d_k, cos_e, sin_e, stats)) {
+
+      collider.collision = true;
+      collider.time      = k;
+      break;
+    }
+  }
+
+  return collider;
+}
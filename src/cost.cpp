@@ -1,16 +1,13 @@
-#include <functional>
+#include <algorithm>
 #include <iterator>
 #include <map>
 #include <math.h>
 #include "Behavior_planning/cost.h"
+#include "Behavior_planning/lane_features.h"
+#include "Behavior_planning/occupancy.h"
 #include "Behavior_planning/vehicle.h"
 
-
-const float REACH_GOAL     = 0.1 * pow(10, 5);
-const float EFFICIENCY     = 2.0 * pow(10, 2);
-const float MAX_ACCELERATE = 1.5 * pow(10, 6);
-const float MAX_SPPED      = 1.5 * pow(10, 6);
-const float LANE_CHANGE    = 1.5 * pow(10, 6);
+static const CostWeights DEFAULT_WEIGHTS = CostWeights();
 
 /*
    Cost increases based on distance of intended lane
@@ -19,19 +16,19 @@ const float LANE_CHANGE    = 1.5 * pow(10, 6);
    Cost of being out of goal lane also becomes larger as vehicle
    approaches goal distance.
 */
-float goal_distance_cost(const Vehicle & vehicle,
-                         const vector<Vehicle> & trajectory,
-                         const map<int, vector<Vehicle>> & predictions,
-                         map<string, float> & data)
+float goal_distance_cost::cost(const Vehicle & vehicle,
+                               const Trajectory & trajectory,
+                               const map<int, vector<Vehicle>> & predictions,
+                               const TrajectoryFeatures & data)
 {
 
     float cost;
-    float distance = data["distance_to_goal"];
+    float distance = data.distance_to_goal;
 
     if (distance > 0) {
 
       float delta_d
-      = 2.0 * vehicle.goal_lane - data["intended_lane"] - data["final_lane"];
+      = 2.0 * vehicle.goal_lane - data.intended_lane - data.final_lane;
 
       cost  = 1 - 2*exp(-(abs(delta_d) / distance));
 
@@ -46,42 +43,46 @@ float goal_distance_cost(const Vehicle & vehicle,
 Cost becomes higher for trajectories with intended lane
 and final lane that have traffic slower than vehicle's target speed.
 */
-float inefficiency_cost(const Vehicle & vehicle,
-                        const vector<Vehicle> & trajectory,
-                        const map<int, vector<Vehicle>> & predictions,
-                        map<string, float> & data)
+float inefficiency_cost::cost(const Vehicle & vehicle,
+                              const Trajectory & trajectory,
+                              const map<int, vector<Vehicle>> & predictions,
+                              const TrajectoryFeatures & data)
 {
 
     float proposed_speed_intended
-     = vehicle_ahead_speed(predictions, data["intended_lane"], vehicle); //= lane_speed(predictions, data["intended_lane"]);
+     = vehicle_ahead_speed(predictions, data.intended_lane, vehicle); //= lane_speed(predictions, data.intended_lane);
 
     // no vehicle
     if ( proposed_speed_intended < 0 ) proposed_speed_intended = vehicle.target_speed;
 
     float proposed_speed_final
-    = vehicle_ahead_speed(predictions, data["final_lane"], vehicle); //= lane_speed(predictions, data["final_lane"]);
+    = vehicle_ahead_speed(predictions, data.final_lane, vehicle); //= lane_speed(predictions, data.final_lane);
 
     // no vehicle
     if ( proposed_speed_final < 0) proposed_speed_final = vehicle.target_speed;
 
+    // a lane is never faster than the target speed, keeps the cost in [0, 2]
+    proposed_speed_intended = min(proposed_speed_intended, vehicle.target_speed);
+    proposed_speed_final    = min(proposed_speed_final, vehicle.target_speed);
+
     float cost
     = (2.0 * vehicle.target_speed - proposed_speed_intended - proposed_speed_final)/vehicle.target_speed;
 
     return cost;
 }
 
-float safety_lane_change_cost(const Vehicle & vehicle,
-                              const vector<Vehicle> & trajectory,
-                              const map<int, vector<Vehicle>> & predictions,
-                              map<string, float> & data)
+float safety_lane_change_cost::cost(const Vehicle & vehicle,
+                                    const Trajectory & trajectory,
+                                    const map<int, vector<Vehicle>> & predictions,
+                                    const TrajectoryFeatures & data)
 {
 
-    if ( data["final_lane"] == data["intended_lane"] ) return 0.0;
+    if ( data.final_lane == data.intended_lane ) return 0.0;
 
     else {
 
       bool vehicle_beside
-      = vehicle_beside_detection(predictions, data["intended_lane"], vehicle);
+      = vehicle_beside_detection(predictions, data.intended_lane, vehicle);
 
       if (vehicle_beside) return 1.0;
       else return 0.0;
@@ -90,10 +91,10 @@ float safety_lane_change_cost(const Vehicle & vehicle,
 }
 
 // Penalizes trajectories that exceed the speed limit.
-float speed_limit_cost(const Vehicle & vehicle,
-                       const vector<Vehicle> & trajectory,
-                       const map<int, vector<Vehicle>> & predictions,
-                       map<string, float> & data)
+float speed_limit_cost::cost(const Vehicle & vehicle,
+                             const Trajectory & trajectory,
+                             const map<int, vector<Vehicle>> & predictions,
+                             const TrajectoryFeatures & data)
 {
 
   //std::cout << " Speed: " << vehicle.v << " | "
@@ -119,33 +120,43 @@ float speed_limit_cost(const Vehicle & vehicle,
 }
 
 // Penalizes trajectories that drive off the road.
-float stays_off_road_cost(const Vehicle & vehicle,
-                          const vector<Vehicle> & trajectory,
-                          const map<int, vector<Vehicle>> & predictions,
-                          map<string, float> & data)
+float stays_off_road_cost::cost(const Vehicle & vehicle,
+                                const Trajectory & trajectory,
+                                const map<int, vector<Vehicle>> & predictions,
+                                const TrajectoryFeatures & data)
 {
 
+    bool final_off_road
+    = data.final_lane < 0 || data.final_lane >= vehicle.lanes_available;
 
+    bool intended_off_road
+    = data.intended_lane < 0 || data.intended_lane >= vehicle.lanes_available;
 
-
+    if (final_off_road || intended_off_road) return 1.0;
+    else return 0.0;
 }
 
-// Penalizes trajectories that do not stay near the center of the lane.
-float center_lane_cost(const Vehicle & vehicle,
-                       const vector<Vehicle> & trajectory,
-                       const map<int, vector<Vehicle>> & predictions,
-                       map<string, float> & data)
+// Penalizes trajectories that do not stay near the center lane of the road,
+// from there both sides stay open for passing.
+float center_lane_cost::cost(const Vehicle & vehicle,
+                             const Trajectory & trajectory,
+                             const map<int, vector<Vehicle>> & predictions,
+                             const TrajectoryFeatures & data)
 {
 
+    float center_lane = (vehicle.lanes_available - 1) / 2.0;
+
+    if (center_lane <= 0) return 0.0;
 
+    return fabs(data.final_lane - center_lane) / center_lane;
 }
 
 // Penalizes trajectories that attempt to accelerate at a rate
 // which is not possible for the vehicle.
-float max_accelerate_cost(const Vehicle & vehicle,
-                          const vector<Vehicle> & trajectory,
-                          const map<int, vector<Vehicle>> & predictions,
-                          map<string, float> & data)
+float max_accelerate_cost::cost(const Vehicle & vehicle,
+                                const Trajectory & trajectory,
+                                const map<int, vector<Vehicle>> & predictions,
+                                const TrajectoryFeatures & data)
 {
 
   //std::cout << " Accelerate: " << vehicle.a << " | "
@@ -181,6 +192,15 @@ float vehicle_ahead_speed(const map<int, vector<Vehicle>> & predictions,
                           int lane, const Vehicle & vehicle)
 {
 
+    if (vehicle.lane_features) {
+
+      const LaneFeature & feature = vehicle.lane_features->lane(lane);
+
+      if (feature.leader_id >= 0 && feature.leader_gap < 40) return feature.leader_speed;
+
+      return -1.0; // no vehicle
+    }
+
     int min_s          = vehicle.goal_s;
     bool found_vehicle = false;
     float speed        = 0;
@@ -201,7 +221,7 @@ float vehicle_ahead_speed(const map<int, vector<Vehicle>> & predictions,
         }
     }
 
-    float shortest_dst = temp_vehicle.s - vehicle.s;
+    float shortest_dst = min_s - vehicle.s;
 
     if (found_vehicle && (shortest_dst < 40) ) return speed;
 
@@ -213,6 +233,12 @@ bool vehicle_behind_detection(const map<int, vector<Vehicle>> & predictions,
                               int lane, const Vehicle & vehicle)
 {
 
+    if (vehicle.lane_features)
+      return vehicle.lane_features->lane(lane).behind_occupied;
+
+    if (vehicle.occupancy_grid)
+      return !vehicle.occupancy_grid->lane_free(lane, vehicle.s - 30, vehicle.s);
+
     int  max_s = -1;
     bool found_vehicle = false;
 
@@ -244,6 +270,12 @@ bool vehicle_beside_detection(const map<int, vector<Vehicle>> & predictions,
                               int lane, const Vehicle & vehicle)
 {
 
+    if (vehicle.lane_features)
+      return vehicle.lane_features->lane(lane).side_occupied;
+
+    if (vehicle.occupancy_grid)
+      return !vehicle.occupancy_grid->lane_free(lane, vehicle.s - 20, vehicle.s + 20);
+
     bool found_vehicle = false;
 
     Vehicle temp_vehicle;
@@ -274,33 +306,44 @@ Sum weighted cost functions to get total cost for trajectory.
 */
 float calculate_cost(const Vehicle & vehicle,
                      const map<int, vector<Vehicle>> & predictions,
-                     const vector<Vehicle> & trajectory)
+                     const Trajectory & trajectory)
 {
 
-    map<string, float> trajectory_data
+    TrajectoryFeatures trajectory_data
     = get_helper_data(vehicle, trajectory, predictions);
 
-    float cost = 0.0;
+    const CostWeights & weights = vehicle.cost_weights ? *vehicle.cost_weights : DEFAULT_WEIGHTS;
+
+    return CostTerms::sum(vehicle, trajectory, predictions, trajectory_data, weights);
+}
+
+/*
+Same as calculate_cost() but stops evaluating cost terms once
+the trajectory can not get cheaper than best_cost, in which case the
+returned value is only a lower bound (>= best_cost) of the cost.
+*/
+float calculate_cost_bounded(const Vehicle & vehicle,
+                             const map<int, vector<Vehicle>> & predictions,
+                             const Trajectory & trajectory,
+                             float best_cost, CostStats & stats)
+{
 
-    //Add additional cost functions here.
-    vector<function<float(const Vehicle &, const vector<Vehicle> &, const map<int, vector<Vehicle>> &, map<string, float> &) >> cost_function_list
-     = {goal_distance_cost, inefficiency_cost, max_accelerate_cost, speed_limit_cost, safety_lane_change_cost};
+    TrajectoryFeatures trajectory_data
+    = get_helper_data(vehicle, trajectory, predictions);
 
-    vector<float> weight_list
-     = {REACH_GOAL, EFFICIENCY, MAX_ACCELERATE, MAX_SPPED, LANE_CHANGE};
+    const CostWeights & weights = vehicle.cost_weights ? *vehicle.cost_weights : DEFAULT_WEIGHTS;
 
-    vector<float> cost_list;
-    for (int i = 0; i < cost_function_list.size(); i++) {
+    int terms_evaluated = 0;
 
-        float new_cost
-        = weight_list[i] * cost_function_list[i](vehicle, trajectory, predictions, trajectory_data);
+    float cost
+    = CostTerms::bounded_sum(vehicle, trajectory, predictions, trajectory_data, weights,
+                             0.0, best_cost, terms_evaluated);
 
-        //cost_list.emplace_back(new_cost);
-        cost += new_cost;
-    }
+    stats.candidates++;
+    stats.terms_evaluated += terms_evaluated;
+    stats.terms_total     += CostTerms::size();
 
-    //cost = cost_list[0] + cost_list[1] + cost_list[2] + cost_list[3]
-    //       + (1 / cost_list[0]) * cost_list[1] * cost_list[1] ;
+    if (terms_evaluated < CostTerms::size()) stats.pruned++;
 
     return cost;
 }
@@ -316,31 +359,28 @@ Note that indended_lane and final_lane are both included to help
 differentiate between planning and executing
 a lane change in the cost functions.
 */
-map<string, float> get_helper_data(const Vehicle & vehicle,
-                                   const vector<Vehicle> & trajectory,
+TrajectoryFeatures get_helper_data(const Vehicle & vehicle,
+                                   const Trajectory & trajectory,
                                    const map<int, vector<Vehicle>> & predictions)
 {
 
-    map<string, float> trajectory_data;
-    Vehicle trajectory_last = trajectory[1];
-
-    float intended_lane;
+    TrajectoryFeatures trajectory_data;
+    const Vehicle & trajectory_last = trajectory[1];
 
-    if (trajectory_last.state.compare("PLCL") == 0)
-        intended_lane = trajectory_last.lane - 1;
+    int intended_lane;
 
-    else if (trajectory_last.state.compare("PLCR") == 0)
-        intended_lane = trajectory_last.lane + 1;
+    if (trajectory_last.state == State::PLCL || trajectory_last.state == State::PLCR)
+        intended_lane = trajectory_last.lane + lane_direction(trajectory_last.state);
 
     else
      intended_lane = trajectory_last.lane;
 
     float distance_to_goal = vehicle.goal_s - trajectory_last.s;
-    float final_lane       = trajectory_last.lane;
+    int   final_lane       = trajectory_last.lane;
 
-    trajectory_data["intended_lane"]    = intended_lane;
-    trajectory_data["final_lane"]       = final_lane;
-    trajectory_data["distance_to_goal"] = distance_to_goal;
+    trajectory_data.intended_lane    = intended_lane;
+    trajectory_data.final_lane       = final_lane;
+    trajectory_data.distance_to_goal = distance_to_goal;
 
     return trajectory_data;
 }
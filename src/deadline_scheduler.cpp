@@ -0,0 +1,199 @@
+#include <algorithm>
+#include "Behavior_planning/deadline_scheduler.h"
+
+const double SlackHistogram::edges[SlackHistogram::bins - 1] = {0, 5, 10, 20, 50, 100, 200, 500};
+
+void SlackHistogram::add(double slack) {
+
+  int bin = 0;
+
+  while (bin < bins - 1 && slack >= edges[bin]) bin++;
+
+  counts[bin]++;
+
+  min_slack  = jobs == 0 ? slack : min(min_slack, slack);
+  sum_slack += slack;
+  misses    += slack < 0;
+  jobs++;
+}
+
+double SlackHistogram::quantile(double q) const {
+
+  long target = (long) (q * jobs), seen = 0;
+
+  for (int bin = 0; bin < bins - 1; bin++) {
+
+    seen += counts[bin];
+
+    if (seen > target) return edges[bin];
+  }
+
+  return edges[bins - 2];
+}
+
+/**
+ * Initializes DeadlineScheduler
+ */
+DeadlineScheduler::DeadlineScheduler(int num_workers) {
+
+  if (num_workers <= 0) num_workers = max(1, (int) thread::hardware_concurrency());
+
+  for (int i = 0; i < num_workers; i++) workers_.emplace_back(&DeadlineScheduler::worker, this);
+}
+
+DeadlineScheduler::~DeadlineScheduler() {
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+
+  work_cv_.notify_all();
+
+  for (thread & worker : workers_) worker.join();
+}
+
+DeadlineScheduler::clock::time_point
+DeadlineScheduler::deadline(clock::time_point received, int prev_size) const {
+
+  return received + chrono::duration_cast<clock::duration>(
+                      chrono::duration<double, milli>(prev_size * point_period));
+}
+
+void DeadlineScheduler::submit(int session, int prev_size, clock::time_point received,
+                               function<void()> work) {
+
+  {
+    lock_guard<mutex> lock(mutex_);
+
+    stats_.submitted++;
+
+    Job job = {session, received, deadline(received, prev_size), move(work)};
+
+    auto pending = find_if(pending_.begin(), pending_.end(),
+                           [session](const Job & j) { return j.session == session; });
+
+    if (pending != pending_.end()) {
+
+      *pending = move(job);
+      stats_.superseded++;
+
+    } else {
+
+      pending_.push_back(move(job));
+    }
+  }
+
+  work_cv_.notify_one();
+}
+
+void DeadlineScheduler::drain() {
+
+  unique_lock<mutex> lock(mutex_);
+  idle_cv_.wait(lock, [this]() { return pending_.empty() && running_.empty(); });
+}
+
+void DeadlineScheduler::forget(int session) {
+
+  vector<Job> dropped;   // released after the lock, they may hold the last session reference
+
+  {
+    lock_guard<mutex> lock(mutex_);
+
+    auto pending = find_if(pending_.begin(), pending_.end(),
+                           [session](const Job & j) { return j.session == session; });
+
+    if (pending != pending_.end()) {
+
+      dropped.push_back(move(*pending));
+      pending_.erase(pending);
+    }
+
+    stats_.sessions.erase(session);
+
+    if (find(running_.begin(), running_.end(), session) != running_.end()) forgotten_.push_back(session);
+  }
+
+  idle_cv_.notify_all();
+}
+
+DeadlineStats DeadlineScheduler::stats() {
+
+  lock_guard<mutex> lock(mutex_);
+  return stats_;
+}
+
+void DeadlineScheduler::reset_stats() {
+
+  lock_guard<mutex> lock(mutex_);
+  stats_ = DeadlineStats();
+}
+
+/*
+   Linear in the pending jobs, one per session at most.
+*/
+int DeadlineScheduler::select() const {
+
+  int best = -1;
+
+  for (int i = 0; i < (int) pending_.size(); i++) {
+
+    const Job & job = pending_[i];
+
+    if (find(running_.begin(), running_.end(), job.session) != running_.end()) continue;
+
+    if (best < 0) { best = i; continue; }
+
+    const Job & other = pending_[best];
+
+    if (dispatch == Dispatch::EDF ? job.deadline < other.deadline
+                                  : job.received < other.received) best = i;
+  }
+
+  return best;
+}
+
+void DeadlineScheduler::worker() {
+
+  unique_lock<mutex> lock(mutex_);
+
+  while (true) {
+
+    int next = -1;
+
+    work_cv_.wait(lock, [this, &next]() { return stop_ || (next = select()) >= 0; });
+
+    if (stop_) return;
+
+    Job job = move(pending_[next]);
+
+    pending_.erase(pending_.begin() + next);
+    running_.push_back(job.session);
+
+    lock.unlock();
+
+    job.work();
+
+    double slack = chrono::duration<double, milli>(job.deadline - clock::now()).count();
+
+    // the closure may hold the last reference to a forgotten session,
+    // destroy it before taking the lock, as forget() does
+    job.work = nullptr;
+
+    lock.lock();
+
+    running_.erase(find(running_.begin(), running_.end(), job.session));
+
+    stats_.completed++;
+    stats_.all.add(slack);
+
+    auto forgotten = find(forgotten_.begin(), forgotten_.end(), job.session);
+
+    if (forgotten != forgotten_.end()) forgotten_.erase(forgotten);
+    else                               stats_.sessions[job.session].add(slack);
+
+    // a job of this session may have been waiting for it
+    work_cv_.notify_all();
+    idle_cv_.notify_all();
+  }
+}
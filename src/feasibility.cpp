@@ -0,0 +1,216 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Behavior_planning/feasibility.h"
+
+/*
+   Speed, longitudinal and lateral acceleration, curvature and jerk at
+   n points, from the points 3, 2, 1 and 0 windows before them (rows
+   p0 to p3), inv_dt being 1 / window duration. For one path the rows
+   are the path shifted by one window, for a time major batch they are
+   the time steps one window apart.
+*/
+static void kinematics(int n, double inv_dt, double min_segment,
+                       const double * __restrict__ x0, const double * __restrict__ y0,
+                       const double * __restrict__ x1, const double * __restrict__ y1,
+                       const double * __restrict__ x2, const double * __restrict__ y2,
+                       const double * __restrict__ x3, const double * __restrict__ y3,
+                       double * __restrict__ speed,
+                       double * __restrict__ lon_accel,
+                       double * __restrict__ curvature,
+                       double * __restrict__ lat_accel,
+                       double * __restrict__ jerk)
+{
+
+  for (int i = 0; i < n; i++) {
+
+    // last three segments, newest last
+    double ax = x1[i] - x0[i], ay = y1[i] - y0[i];
+    double bx = x2[i] - x1[i], by = y2[i] - y1[i];
+    double cx = x3[i] - x2[i], cy = y3[i] - y2[i];
+
+    double len_b = sqrt(bx * bx + by * by);
+    double len_c = sqrt(cx * cx + cy * cy);
+
+    double v_b = len_b * inv_dt;
+    double v_c = len_c * inv_dt;
+
+    double cross = bx * cy - by * cx;
+    double chord = sqrt((bx + cx) * (bx + cx) + (by + cy) * (by + cy));
+
+    double k = 2 * fabs(cross) / max(len_b * len_c * chord, 1e-12);
+
+    k = min(len_b, len_c) > min_segment ? k : 0.0;
+
+    double v  = 0.5 * (v_b + v_c);
+
+    double jx = cx - 2 * bx + ax;
+    double jy = cy - 2 * by + ay;
+
+    speed[i]     = v_c;
+    lon_accel[i] = (v_c - v_b) * inv_dt;
+    curvature[i] = k;
+    lat_accel[i] = v * v * k;
+    jerk[i]      = sqrt(jx * jx + jy * jy) * inv_dt * inv_dt * inv_dt;
+  }
+}
+
+double FeasibilityChecker::max_curvature() const {
+
+  return tan(max_steer) / wheelbase;
+}
+
+int FeasibilityChecker::check(const vector<double> & x, const vector<double> & y) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  int n = x.size();
+
+  stats        = FeasibilityStats();
+  stats.points = n;
+
+  speed_.assign(n, 0);
+  lon_accel_.assign(n, 0);
+  curvature_.assign(n, 0);
+  lat_accel_.assign(n, 0);
+  jerk_.assign(n, 0);
+
+  int    w      = max(1, window);
+  double inv_dt = 1 / (w * dt);
+
+  const double * px = x.data();
+  const double * py = y.data();
+
+  // points w to 2w have a speed only, points 2w to 3w no jerk yet: the
+  // missing rows are clamped to the oldest one and what they cannot
+  // give is cleared
+  int speed_only = max(0, min(w, n - w));
+  int no_jerk    = max(0, min(w, n - 2 * w));
+
+  kinematics(speed_only, inv_dt, min_segment, px, py, px, py, px, py, px + w, py + w,
+             &speed_[w], &lon_accel_[w], &curvature_[w], &lat_accel_[w], &jerk_[w]);
+
+  kinematics(no_jerk, inv_dt, min_segment, px, py, px, py, px + w, py + w, px + 2 * w, py + 2 * w,
+             &speed_[2 * w], &lon_accel_[2 * w], &curvature_[2 * w], &lat_accel_[2 * w], &jerk_[2 * w]);
+
+  if (n > 3 * w) {
+
+    kinematics(n - 3 * w, inv_dt, min_segment, px, py, px + w, py + w,
+               px + 2 * w, py + 2 * w, px + 3 * w, py + 3 * w,
+               &speed_[3 * w], &lon_accel_[3 * w], &curvature_[3 * w], &lat_accel_[3 * w], &jerk_[3 * w]);
+  }
+
+  for (int i = w; i < w + speed_only; i++) lon_accel_[i] = curvature_[i] = lat_accel_[i] = 0;
+
+  for (int i = w; i < 2 * w + no_jerk; i++) jerk_[i] = 0;
+
+  double k_max = max_curvature();
+
+  // first violation as a min reduction over the points
+  int first = n;
+
+  for (int i = 0; i < n; i++) {
+
+    double over = (speed_[i]     >  max_speed         ? 1.0 : 0.0)
+                + (lon_accel_[i] >  max_accel         ? 1.0 : 0.0)
+                + (lon_accel_[i] < -max_decel         ? 1.0 : 0.0)
+                + (lat_accel_[i] >  max_lateral_accel ? 1.0 : 0.0)
+                + (jerk_[i]      >  max_jerk          ? 1.0 : 0.0)
+                + (curvature_[i] >  k_max             ? 1.0 : 0.0);
+
+    first = min(first, over > 0 ? i : n);
+  }
+
+  for (int i = 0; i < n; i++) {
+
+    stats.speed     = max(stats.speed, speed_[i]);
+    stats.lon_accel = max(stats.lon_accel, fabs(lon_accel_[i]));
+    stats.lat_accel = max(stats.lat_accel, lat_accel_[i]);
+    stats.jerk      = max(stats.jerk, jerk_[i]);
+    stats.curvature = max(stats.curvature, curvature_[i]);
+  }
+
+  if (first < n) {
+
+    stats.first = first;
+
+    if      (speed_[first] > max_speed)                   stats.violation = Violation::SPEED;
+    else if (lon_accel_[first] > max_accel ||
+             lon_accel_[first] < -max_decel)              stats.violation = Violation::LONGITUDINAL_ACCEL;
+    else if (lat_accel_[first] > max_lateral_accel)       stats.violation = Violation::LATERAL_ACCEL;
+    else if (jerk_[first] > max_jerk)                     stats.violation = Violation::JERK;
+    else                                                  stats.violation = Violation::CURVATURE;
+  }
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  stats.elapsed_ms = elapsed.count();
+
+  return stats.first;
+}
+
+void FeasibilityChecker::check_batch(const double * x, const double * y, int paths, int points,
+                                     int * first) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  stats        = FeasibilityStats();
+  stats.points = paths * points;
+
+  speed_.resize(paths);
+  lon_accel_.resize(paths);
+  curvature_.resize(paths);
+  lat_accel_.resize(paths);
+  jerk_.resize(paths);
+
+  int    w      = max(1, window);
+  double inv_dt = 1 / (w * dt);
+  double k_max  = max_curvature();
+  double inf    = numeric_limits<double>::infinity();
+
+  fill(first, first + paths, points);
+
+  for (int t = w; t < points; t++) {
+
+    // rows before the first point are clamped to it, the limits of
+    // the quantities they cannot give are lifted
+    int t0 = max(0, t - 3 * w), t1 = max(0, t - 2 * w), t2 = t - w;
+
+    kinematics(paths, inv_dt, min_segment,
+               x + t0 * paths, y + t0 * paths, x + t1 * paths, y + t1 * paths,
+               x + t2 * paths, y + t2 * paths, x + t  * paths, y + t  * paths,
+               &speed_[0], &lon_accel_[0], &curvature_[0], &lat_accel_[0], &jerk_[0]);
+
+    double accel_limit = t >= 2 * w ? max_accel         : inf;
+    double decel_limit = t >= 2 * w ? max_decel         : inf;
+    double lat_limit   = t >= 2 * w ? max_lateral_accel : inf;
+    double k_limit     = t >= 2 * w ? k_max             : inf;
+    double jerk_limit  = t >= 3 * w ? max_jerk          : inf;
+
+    for (int p = 0; p < paths; p++) {
+
+      double over = (speed_[p]     >  max_speed   ? 1.0 : 0.0)
+                  + (lon_accel_[p] >  accel_limit ? 1.0 : 0.0)
+                  + (lon_accel_[p] < -decel_limit ? 1.0 : 0.0)
+                  + (lat_accel_[p] >  lat_limit   ? 1.0 : 0.0)
+                  + (jerk_[p]      >  jerk_limit  ? 1.0 : 0.0)
+                  + (curvature_[p] >  k_limit     ? 1.0 : 0.0);
+
+      first[p] = min(first[p], over > 0 ? t : points);
+    }
+  }
+
+  for (int p = 0; p < paths; p++) {
+
+    first[p] = first[p] < points ? first[p] : -1;
+
+    if (first[p] < 0) stats.feasible++;
+
+    else if (stats.first < 0 || first[p] < stats.first) stats.first = first[p];
+  }
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  stats.elapsed_ms = elapsed.count();
+}
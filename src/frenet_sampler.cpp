@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Behavior_planning/frenet_sampler.h"
+
+/*
+   Ego positions of candidates [0, n) at time t, the polynomials are
+   clamped at T and the end state held after it.
+*/
+static void position_step(float t, int n,
+                          float s0, float v0, float s_c2,
+                          float d0, float d_dot0, float d_c2,
+                          const float * __restrict__ T,
+                          const float * __restrict__ v1,
+                          const float * __restrict__ s_c3,
+                          const float * __restrict__ s_c4,
+                          const float * __restrict__ d_c3,
+                          const float * __restrict__ d_c4,
+                          const float * __restrict__ d_c5,
+                          float * __restrict__ s_out,
+                          float * __restrict__ d_out)
+{
+
+  for (int i = 0; i < n; i++) {
+
+    float tt    = t < T[i] ? t : T[i];
+    float extra = t - tt;
+
+    s_out[i] = s0 + tt * (v0 + tt * (s_c2 + tt * (s_c3[i] + tt * s_c4[i]))) + v1[i] * extra;
+    d_out[i] = d0 + tt * (d_dot0 + tt * (d_c2 + tt * (d_c3[i] + tt * (d_c4[i] + tt * d_c5[i]))));
+  }
+}
+
+/*
+   Marks the candidates [0, n) overlapping one predicted vehicle at
+   (s, d). ds is folded across the track seam.
+*/
+static void overlap_step(int n, float s, float d, float max_s,
+                         float length, float width,
+                         const float * __restrict__ ego_s,
+                         const float * __restrict__ ego_d,
+                         float * __restrict__ hit)
+{
+
+  float half_s = 0.5f * max_s;
+
+  for (int i = 0; i < n; i++) {
+
+    float ds = ego_s[i] - s;
+    float dd = ego_d[i] - d;
+
+    ds = ds >  half_s ? ds - max_s : ds;
+    ds = ds < -half_s ? ds + max_s : ds;
+
+    bool overlap = fabsf(ds) < length && fabsf(dd) < width;
+
+    hit[i] = overlap ? 1.0f : hit[i];
+  }
+}
+
+int FrenetSampler::plan(float s, float v, float a, float d, int goal_lane,
+                        const Prediction & prediction) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  sample(s, v, a, d, goal_lane);
+  score(prediction);
+  select();
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  stats.elapsed_ms = elapsed.count();
+
+  return best;
+}
+
+/*
+   Builds the lane x speed x horizon grid of candidates from the ego
+   state, in the ego lane and the adjacent ones. Storage only grows when
+   the grid gets bigger.
+*/
+void FrenetSampler::sample(float s, float v, float a, float d, int goal_lane) {
+
+  this->s0      = s;
+  this->v0      = v;
+  this->a0      = a;
+  this->d0      = d;
+  this->d_dot0  = 0;
+  this->d_ddot0 = 0;
+
+  this->lane0     = max(0, min(num_lanes - 1, (int) (d / lane_width)));
+  this->goal_lane = goal_lane;
+
+  // one lane change at a time, as the FSM
+  int first_lane = max(0, lane0 - 1);
+  int last_lane  = min(num_lanes - 1, lane0 + 1);
+
+  this->size = (last_lane - first_lane + 1) * num_speeds * num_horizons;
+
+  vector<float> * arrays[] = { &T, &v1, &d1, &s_c3, &s_c4, &d_c3, &d_c4, &d_c5,
+                               &accel, &comfort, &efficiency, &preference, &collision, &cost,
+                               &ego_s_, &ego_d_, &hit_ };
+
+  for (vector<float> * array : arrays) if ((int) array->size() < size) array->resize(size);
+
+  if ((int) lane.size() < size) lane.resize(size);
+
+  int i = 0;
+
+  for (int l = first_lane; l <= last_lane; l++) {
+
+    float d_end = (l + 0.5f) * lane_width;
+
+    for (int k = 0; k < num_speeds; k++) {
+
+      float v_end = num_speeds > 1
+                  ? min_speed + (max_speed - min_speed) * k / (num_speeds - 1)
+                  : max_speed;
+
+      for (int h = 0; h < num_horizons; h++, i++) {
+
+        float t_end = num_horizons > 1
+                    ? min_horizon + (max_horizon - min_horizon) * h / (num_horizons - 1)
+                    : max_horizon;
+
+        float t2 = t_end * t_end;
+        float t3 = t2 * t_end;
+
+        lane[i] = l;
+        T[i]    = t_end;
+        v1[i]   = v_end;
+        d1[i]   = d_end;
+
+        // quartic, s'(T) = v_end, s''(T) = 0
+        float b1 = v_end - v0 - a0 * t_end;
+        float b2 = -a0;
+
+        s_c3[i] = (3 * b1 - t_end * b2) / (3 * t2);
+        s_c4[i] = (t_end * b2 - 2 * b1) / (4 * t3);
+
+        // quintic, d(T) = d_end, d'(T) = d''(T) = 0
+        float delta_d = d_end - d0;
+
+        d_c3[i] = (20 * delta_d - 12 * d_dot0 * t_end - 3 * d_ddot0 * t2) / (2 * t3);
+        d_c4[i] = (-30 * delta_d + 16 * d_dot0 * t_end + 3 * d_ddot0 * t2) / (2 * t2 * t2);
+        d_c5[i] = (12 * delta_d - 6 * d_dot0 * t_end - d_ddot0 * t2) / (2 * t3 * t2);
+      }
+    }
+  }
+
+  stats.candidates = size;
+}
+
+/*
+   Cost terms of every candidate, in blocks of block_size candidates,
+   on the pool when the batch is large.
+*/
+void FrenetSampler::score(const Prediction & prediction) {
+
+  if (size >= parallel_threshold) {
+
+    if (!pool_) pool_ = make_shared<ThreadPool>(num_threads);
+
+    const Prediction * traffic = &prediction;
+
+    stats.threads = pool_->parallel_for(size, block_size, [this, traffic](int begin, int end) {
+      score_block(begin, end, *traffic);
+    });
+
+  } else {
+
+    for (int begin = 0; begin < size; begin += block_size)
+      score_block(begin, min(begin + block_size, size), prediction);
+
+    stats.threads = 1;
+  }
+}
+
+void FrenetSampler::score_block(int begin, int end, const Prediction & prediction) {
+
+  int n = end - begin;
+
+  const float * T_b    = &T[begin];
+  const float * v1_b   = &v1[begin];
+  const float * s_c3_b = &s_c3[begin];
+  const float * s_c4_b = &s_c4[begin];
+  const float * d_c3_b = &d_c3[begin];
+  const float * d_c4_b = &d_c4[begin];
+  const float * d_c5_b = &d_c5[begin];
+
+  float * ego_s = &ego_s_[begin];
+  float * ego_d = &ego_d_[begin];
+  float * hit   = &hit_[begin];
+
+  // traffic independent terms
+  for (int i = 0; i < n; i++) {
+
+    float t  = T_b[i];
+    float c3 = s_c3_b[i], c4 = s_c4_b[i];
+    float e3 = d_c3_b[i], e4 = d_c4_b[i], e5 = d_c5_b[i];
+
+    // integral of squared jerk over [0, T]
+    float jerk_s = t * (36 * c3 * c3 + t * (144 * c3 * c4 + t * 192 * c4 * c4));
+    float jerk_d = t * (36 * e3 * e3 + t * (144 * e3 * e4 + t * (192 * e4 * e4 + 240 * e3 * e5
+                   + t * (720 * e4 * e5 + t * 720 * e5 * e5))));
+
+    // s''(t) = a0 + 6 c3 t + 12 c4 t^2 peaks at t = -c3 / (4 c4)
+    float t_peak = c4 != 0 ? -c3 / (4 * c4) : 0;
+    t_peak = t_peak > 0 ? t_peak : 0;
+    t_peak = t_peak < t ? t_peak : t;
+
+    float a_peak = fabsf(a0 + 6 * c3 * t_peak + 12 * c4 * t_peak * t_peak);
+    float dv     = max_speed - v1_b[i];
+
+    accel[begin + i]      = a_peak > fabsf(a0) ? a_peak : fabsf(a0);
+    comfort[begin + i]    = w_jerk * (jerk_s + jerk_d) + w_time * t;
+    efficiency[begin + i] = w_speed * dv * dv;
+    hit[i]                = 0;
+  }
+
+  for (int i = 0; i < n; i++) {
+
+    int l = lane[begin + i];
+
+    preference[begin + i] = w_lane * abs(l - goal_lane) + (l != lane0 ? w_lane_change : 0);
+  }
+
+  // collision against every predicted vehicle, one time step at a time
+  for (int k = 1; k < prediction.steps; k++) {
+
+    position_step(prediction.time_at(k), n, s0, v0, 0.5f * a0, d0, d_dot0, 0.5f * d_ddot0,
+                  T_b, v1_b, s_c3_b, s_c4_b, d_c3_b, d_c4_b, d_c5_b, ego_s, ego_d);
+
+    const float * s_row = prediction.s_row(k);
+    const float * d_row = prediction.d_row(k);
+
+    for (int j = 0; j < prediction.size; j++)
+      overlap_step(n, s_row[j], d_row[j], max_s, vehicle_length, vehicle_width, ego_s, ego_d, hit);
+  }
+
+  for (int i = 0; i < n; i++) {
+
+    float infeasible = accel[begin + i] > max_accel ? 1.0f : 0.0f;
+
+    collision[begin + i] = hit[i];
+    cost[begin + i]      = comfort[begin + i] + efficiency[begin + i] + preference[begin + i]
+                         + w_collision * (hit[i] + infeasible);
+  }
+}
+
+int FrenetSampler::select() {
+
+  float best_cost = numeric_limits<float>::infinity();
+
+  best             = -1;
+  stats.collisions = 0;
+  stats.infeasible = 0;
+
+  for (int i = 0; i < size; i++) {
+
+    if (collision[i] != 0)     stats.collisions++;
+    if (accel[i] > max_accel)  stats.infeasible++;
+
+    if (cost[i] < best_cost) {
+
+      best_cost = cost[i];
+      best      = i;
+    }
+  }
+
+  return best;
+}
+
+float FrenetSampler::s_at(int i, float t) const {
+
+  float tt = min(t, T[i]);
+
+  return s0 + tt * (v0 + tt * (0.5f * a0 + tt * (s_c3[i] + tt * s_c4[i]))) + v1[i] * (t - tt);
+}
+
+float FrenetSampler::d_at(int i, float t) const {
+
+  float tt = min(t, T[i]);
+
+  return d0 + tt * (d_dot0 + tt * (0.5f * d_ddot0 + tt * (d_c3[i] + tt * (d_c4[i] + tt * d_c5[i]))));
+}
+
+/*
+   s(t) never decreases for the sampled speeds, so bisect t over [0, T].
+*/
+float FrenetSampler::d_at_s(int i, float s) const {
+
+  if (s >= s_at(i, T[i])) return d1[i];
+
+  float t0 = 0, t1 = T[i];
+
+  for (int iteration = 0; iteration < 20; iteration++) {
+
+    float t = 0.5f * (t0 + t1);
+
+    if (s_at(i, t) < s) t0 = t;
+    else                t1 = t;
+  }
+
+  return d_at(i, 0.5f * (t0 + t1));
+}
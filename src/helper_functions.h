@@ -1,12 +1,25 @@
+#ifndef HELPER_FUNCTIONS_H
+#define HELPER_FUNCTIONS_H
+#include <fstream>
+#include <math.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Behavior_planning/spline.h"
+#include "Behavior_planning/path_smoother.h"
+#include "Behavior_planning/maneuver_templates.h"
+
+using namespace std;
+
 // For converting back and forth between radians and degrees.
 constexpr double pi() { return M_PI; }
-double deg2rad(double x) { return x * pi() / 180; }
-double rad2deg(double x) { return x * 180 / pi(); }
+inline double deg2rad(double x) { return x * pi() / 180; }
+inline double rad2deg(double x) { return x * 180 / pi(); }
 
 // Checks if the SocketIO event has JSON data.
 // If there is data the JSON object in string format will be returned,
 // else the empty string "" will be returned.
-string hasData(string s)
+inline string hasData(string s)
 {
   auto found_null = s.find("null");
   auto b1 = s.find_first_of("[");
@@ -19,12 +32,12 @@ string hasData(string s)
   return "";
 }
 
-double distance(double x1, double y1, double x2, double y2)
+inline double distance(double x1, double y1, double x2, double y2)
 {
 	return sqrt((x2-x1)*(x2-x1)+(y2-y1)*(y2-y1));
 }
 
-int ClosestWaypoint(double x, double y,
+inline int ClosestWaypoint(double x, double y,
                     const vector<double> &maps_x,
                     const vector<double> &maps_y)
 {
@@ -50,7 +63,7 @@ int ClosestWaypoint(double x, double y,
 
 }
 
-int NextWaypoint(double x, double y, double theta,
+inline int NextWaypoint(double x, double y, double theta,
                  const vector<double> &maps_x,
                  const vector<double> &maps_y)
 {
@@ -78,7 +91,7 @@ int NextWaypoint(double x, double y, double theta,
 }
 
 // Transform from Cartesian x,y coordinates to Frenet s,d coordinates
-vector<double> getFrenet(double x, double y, double theta,
+inline vector<double> getFrenet(double x, double y, double theta,
                          const vector<double> &maps_x,
                          const vector<double> &maps_y)
 {
@@ -129,7 +142,7 @@ vector<double> getFrenet(double x, double y, double theta,
 }
 
 // Transform from Frenet s,d coordinates to Cartesian x,y
-vector<double> getXY(double s, double d,
+inline vector<double> getXY(double s, double d,
                     const vector<double> &maps_s,
                     const vector<double> &maps_x,
                     const vector<double> &maps_y)
@@ -159,7 +172,7 @@ vector<double> getXY(double s, double d,
 }
 
 
-void load_Waypoints(vector<double> & map_waypoints_x,
+inline void load_Waypoints(vector<double> & map_waypoints_x,
                     vector<double> & map_waypoints_y,
                     vector<double> & map_waypoints_s,
                     vector<double> & map_waypoints_dx,
@@ -213,6 +226,14 @@ struct Waypoints {
   vector<double> map_waypoints_s, map_waypoints_x, map_waypoints_y;
   vector<double> previous_path_x, previous_path_y;
 
+  // if set, anchors are taken from the smoothed reference path
+  PathSmoother * smoother = nullptr;
+
+  // if set and active, the new points follow the lane change template
+  // laterally, the spline only carries the road
+  const ManeuverTemplates * templates = nullptr;
+  LaneChange *              lane_change = nullptr;
+
   Waypoints (const int _prev_size, const int _lane,
              double _car_x, double _car_y, double _car_yaw, double _car_s,
              vector<double> _map_waypoints_s, vector<double> _map_waypoints_x,
@@ -225,6 +246,33 @@ struct Waypoints {
     previous_path_y (_previous_path_y) {};
 
   void spaced_waypoints_generator ()
+  {
+    double d = 2+4*lane;
+
+    // during a lane change, the d reached at the end of the previous path
+    if (maneuvering()) d = lane_change->d(*templates, lane_change->step - 1);
+
+    // In Frenet add evenly 30m spaced points ahead of the starting reference
+    spaced_waypoints_generator({car_s + 30, car_s + 60, car_s + 90}, {d, d, d});
+
+    // the spline only carries the road, the template adds the lateral
+    // motion: move the point before the reference to the same d
+    if (maneuvering()) {
+
+      int step = lane_change->step;
+
+      ptsy[0] -= lane_change->d(*templates, step - 1) - lane_change->d(*templates, step - 2);
+    }
+  }
+
+  bool maneuvering () const
+  {
+    return templates && lane_change && lane_change->active();
+  }
+
+  // same with the Frenet anchor points given, e.g. from a sampled trajectory
+  void spaced_waypoints_generator (const vector<double> & anchor_s,
+                                   const vector<double> & anchor_d)
   {
     ref_x   = car_x;
     ref_y   = car_y;
@@ -264,23 +312,21 @@ struct Waypoints {
 
     }
 
-    // In Frenet add evenly 30m spaced points ahead of the starting reference
-    std::vector<double> next_wp0 =
-      getXY(car_s + 30, (2+4*lane), map_waypoints_s, map_waypoints_x, map_waypoints_y);
+    if (smoother) {
+
+      smoothed_anchors(anchor_s, anchor_d);
 
-    std::vector<double> next_wp1 =
-      getXY(car_s + 60, (2+4*lane), map_waypoints_s, map_waypoints_x, map_waypoints_y);
+    } else {
 
-    std::vector<double> next_wp2 =
-      getXY(car_s + 90, (2+4*lane), map_waypoints_s, map_waypoints_x, map_waypoints_y);
-      ptsx.push_back(next_wp0[0]);
+      for (int i = 0; i < anchor_s.size(); i++){
 
-    ptsx.push_back(next_wp1[0]);
-    ptsx.push_back(next_wp2[0]);
+        std::vector<double> next_wp =
+          getXY(anchor_s[i], anchor_d[i], map_waypoints_s, map_waypoints_x, map_waypoints_y);
 
-    ptsy.push_back(next_wp0[1]);
-    ptsy.push_back(next_wp1[1]);
-    ptsy.push_back(next_wp2[1]);
+        ptsx.push_back(next_wp[0]);
+        ptsy.push_back(next_wp[1]);
+      }
+    }
 
     for (int i = 0; i < ptsx.size(); i++){
 
@@ -295,7 +341,67 @@ struct Waypoints {
 
   }
 
+  // anchors from reference nodes every smoother->spacing meters from car_s
+  // to the last anchor, d linear between the anchors, moved within the
+  // lane corridor to smooth out the kinks of the map
+  void smoothed_anchors (const vector<double> & anchor_s,
+                         const vector<double> & anchor_d)
+  {
+    PathSmoother & sm = *smoother;
+
+    int n = (int) ((anchor_s.back() - car_s) / sm.spacing) + 1;
+
+    sm.ref_x.resize(n);
+    sm.ref_y.resize(n);
+    sm.normal_x.resize(n);
+    sm.normal_y.resize(n);
+    sm.lower.assign(n, -sm.corridor);
+    sm.upper.assign(n,  sm.corridor);
+
+    int k = 0;
+
+    for (int i = 0; i < n; i++){
+
+      double s = car_s + i * sm.spacing;
+
+      while (k + 1 < anchor_s.size() && anchor_s[k] < s) k++;
+
+      double d = anchor_d[k];
+
+      if (k > 0 && s < anchor_s[k]) {
+
+        double f = (s - anchor_s[k-1]) / (anchor_s[k] - anchor_s[k-1]);
+
+        d = anchor_d[k-1] + f * (anchor_d[k] - anchor_d[k-1]);
+      }
+
+      vector<double> node    = getXY(s, d,     map_waypoints_s, map_waypoints_x, map_waypoints_y);
+      vector<double> outward = getXY(s, d + 1, map_waypoints_s, map_waypoints_x, map_waypoints_y);
+
+      sm.ref_x[i]    = node[0];
+      sm.ref_y[i]    = node[1];
+      sm.normal_x[i] = outward[0] - node[0];
+      sm.normal_y[i] = outward[1] - node[1];
+    }
+
+    sm.smooth();
+
+    for (int i = 0; i < anchor_s.size(); i++){
+
+      int node = min(n - 1, (int) ((anchor_s[i] - car_s) / sm.spacing + 0.5));
+
+      ptsx.push_back(sm.x[node]);
+      ptsy.push_back(sm.y[node]);
+    }
+  }
+
   void detailed_waypoints_generator (double ref_vel)
+  {
+    detailed_waypoints_generator(vector<double>(1, ref_vel));
+  }
+
+  // speeds [mph], one per new path point, the last one repeats
+  void detailed_waypoints_generator (const vector<double> & speeds)
   {
     // create a spline
     tk::spline s;
@@ -321,12 +427,24 @@ struct Waypoints {
     // Fill up the rest of our path planner after filling
     // it with previous points, here we will alwawys 50 set_points
 
+    bool   maneuver = maneuvering();
+    double ref_d    = maneuver ? lane_change->d(*templates, lane_change->step - 1) : 0;
+
     for (int i = 1; i <= 50 - previous_path_x.size(); i++){
 
+      double ref_vel = speeds[min(i, (int) speeds.size()) - 1];
+
       double N       = target_dist / (.02 * ref_vel/2.24);
-      double x_point = x_add_on + (target_x) / N;
+      double x_step  = (target_x) / N;
+
+      if (maneuver) x_step *= templates->advance_at(lane_change->id, lane_change->step);
+
+      double x_point = x_add_on + x_step;
       double y_point = s(x_point);
 
+      // d grows to the right, y to the left
+      if (maneuver) y_point -= lane_change->d(*templates, lane_change->step++) - ref_d;
+
       x_add_on = x_point;
 
       double x_ref = x_point;
@@ -344,6 +462,11 @@ struct Waypoints {
 
     }
 
+    if (maneuver && lane_change->step >= templates->steps[lane_change->id])
+      lane_change->id = -1;
+
   }
 
 };
+
+#endif
@@ -0,0 +1,94 @@
+#include <cmath>
+#include "Behavior_planning/lane_features.h"
+#include "Behavior_planning/occupancy.h"
+
+/*
+   Fills the features of every lane from the current step of the
+   predictions. Gap checks come from the occupancy grid when there is one.
+*/
+void LaneFeatures::update(const Vehicle & ego, const map<int, vector<Vehicle>> & predictions,
+                          const OccupancyGrid * occupancy_grid) {
+
+  int num_lanes = ego.lanes_available;
+
+  lanes.assign(num_lanes, LaneFeature());
+
+  flow_count_.assign(num_lanes, 0);
+
+  for (LaneFeature & feature : lanes) feature.flow_speed = 0;
+
+  for (map<int, vector<Vehicle>>::const_iterator it = predictions.begin(); it != predictions.end(); ++it)
+  {
+
+    if (it->first == -1) continue; // skip for ego car "road.h"
+
+    const Vehicle & vehicle = it->second[0];
+    int l = vehicle.lane;
+
+    if (l < 0 || l >= num_lanes) continue;
+
+    LaneFeature & feature = lanes[l];
+
+    if (vehicle.s > ego.s && vehicle.s < ego.goal_s
+        && (feature.leader_id < 0 || vehicle.s < feature.leader.s)) {
+
+      feature.leader_id    = it->first;
+      feature.leader       = vehicle;
+    }
+
+    if (vehicle.s < ego.s && vehicle.s > -1
+        && (feature.follower_id < 0 || vehicle.s > feature.follower.s)) {
+
+      feature.follower_id  = it->first;
+      feature.follower     = vehicle;
+    }
+
+    if (abs(ego.s - vehicle.s) < 20) feature.side_occupied = true;
+
+    if (vehicle.s <= ego.s && ego.s - vehicle.s < 30) feature.behind_occupied = true;
+
+    if (vehicle.s >= ego.s && vehicle.s - ego.s < flow_range) {
+
+      feature.flow_speed += vehicle.v;
+      flow_count_[l]++;
+    }
+  }
+
+  for (int l = 0; l < num_lanes; l++) {
+
+    LaneFeature & feature = lanes[l];
+
+    if (feature.leader_id >= 0) {
+
+      feature.leader_gap   = feature.leader.s - ego.s;
+      feature.leader_speed = feature.leader.v;
+    }
+
+    if (feature.follower_id >= 0) {
+
+      feature.follower_gap   = ego.s - feature.follower.s;
+      feature.follower_speed = feature.follower.v;
+    }
+
+    feature.flow_speed = (flow_count_[l] > 0) ? feature.flow_speed / flow_count_[l] : -1;
+
+    if (occupancy_grid) {
+
+      feature.side_occupied   = !occupancy_grid->lane_free(l, ego.s - 20, ego.s + 20);
+      feature.behind_occupied = !occupancy_grid->lane_free(l, ego.s - 30, ego.s);
+    }
+  }
+
+  this->lookups           = 0;
+  this->scans             = 1;
+  this->vehicles_per_scan = predictions.size();
+}
+
+const LaneFeature & LaneFeatures::lane(int lane) const {
+
+  this->lookups++;
+
+  if (lane < 0 || lane >= (int) lanes.size()) return off_road_;
+
+  return lanes[lane];
+}
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include "Behavior_planning/lattice.h"
+
+/*
+   Footprint cells of a primitive, one per footprint_dt. A lane change
+   covers the start lane until 60% of its duration and the target lane
+   from 40% on, so both lanes are covered while it crosses the line.
+*/
+static void sweep(const Primitive & primitive, float v0, float v1, float duration, float dt,
+                  float length, vector<FootprintCell> & footprints)
+{
+
+  float a = (v1 - v0) / duration;
+
+  for (float t0 = 0; t0 < duration - 1e-3f; t0 += dt) {
+
+    float t1 = min(t0 + dt, duration);
+
+    FootprintCell cell;
+
+    cell.t0 = t0;
+    cell.t1 = t1;
+    cell.s0 = v0 * t0 + 0.5f * a * t0 * t0 - 0.5f * length;
+    cell.s1 = v0 * t1 + 0.5f * a * t1 * t1 + 0.5f * length;
+
+    if (primitive.lane_offset == 0 || t0 < 0.6f * duration) {
+
+      cell.lane_offset = 0;
+      footprints.push_back(cell);
+    }
+
+    if (primitive.lane_offset != 0 && t1 > 0.4f * duration) {
+
+      cell.lane_offset = primitive.lane_offset;
+      footprints.push_back(cell);
+    }
+  }
+}
+
+void MotionLattice::build() {
+
+  primitives.clear();
+  footprints.clear();
+  first_primitive.assign(num_speeds + 1, 0);
+
+  for (int v0 = 0; v0 < num_speeds; v0++) {
+
+    first_primitive[v0] = primitives.size();
+
+    for (int lane_offset = -1; lane_offset <= 1; lane_offset++) {
+
+      int   steps    = lane_offset == 0 ? 1 : 2;
+      float duration = steps * step_dt;
+
+      if (lane_offset != 0 && speed(v0) < min_change_speed) continue;
+
+      for (int v1 = 0; v1 < num_speeds; v1++) {
+
+        float a = (speed(v1) - speed(v0)) / duration;
+
+        if (fabs(a) > max_accel) continue;
+
+        if (lane_offset != 0 && speed(v1) < min_change_speed) continue;
+
+        Primitive primitive;
+
+        primitive.v0          = v0;
+        primitive.v1          = v1;
+        primitive.lane_offset = lane_offset;
+        primitive.steps       = steps;
+        primitive.ds          = 0.5f * (speed(v0) + speed(v1)) * duration;
+        primitive.cost        = w_accel * a * a * duration
+                              + w_progress * (max_speed * duration - primitive.ds)
+                              + w_lane_change * abs(lane_offset);
+
+        primitive.footprint_begin = footprints.size();
+        sweep(primitive, speed(v0), speed(v1), duration, footprint_dt, vehicle_length, footprints);
+        primitive.footprint_end   = footprints.size();
+
+        primitives.push_back(primitive);
+      }
+    }
+  }
+
+  first_primitive[num_speeds] = primitives.size();
+
+  primitives_per_node = 0;
+
+  for (int v0 = 0; v0 < num_speeds; v0++)
+    primitives_per_node = max(primitives_per_node, first_primitive[v0 + 1] - first_primitive[v0]);
+
+  // merged states, time steps past the horizon fold into the last one
+  s_bins_ = (int) ceil(max_speed * step_dt * (num_steps + 1) / s_resolution) + 1;
+
+  best_g_.assign((num_steps + 1) * num_lanes * num_speeds * s_bins_, 0);
+  stamp_.assign(best_g_.size(), 0);
+
+  // every expansion pushes at most primitives_per_node nodes, no
+  // reallocation during the search
+  nodes_.reserve(max_expansions * primitives_per_node + 1);
+  open_.reserve(max_expansions * primitives_per_node + 1);
+  path.reserve(num_steps);
+}
+
+bool MotionLattice::collision_free(const Primitive & primitive, float s, int lane, float t,
+                                   const OccupancyGrid & occupancy_grid) {
+
+  for (int c = primitive.footprint_begin; c < primitive.footprint_end; c++) {
+
+    const FootprintCell & cell = footprints[c];
+
+    stats.cell_checks++;
+
+    if (!occupancy_grid.lane_free(lane + cell.lane_offset, s + cell.s0, s + cell.s1,
+                                  t + cell.t0, t + cell.t1)) return false;
+  }
+
+  return true;
+}
+
+/*
+   Every lane away from the goal costs at least a lane change or the
+   lane preference over the remaining time.
+*/
+float MotionLattice::heuristic(int lane, int goal_lane, int step) const {
+
+  float remaining = max(0, num_steps - step) * step_dt;
+
+  return min(w_lane_change, w_lane * remaining) * abs(lane - goal_lane);
+}
+
+int MotionLattice::plan(float s, float v, int lane, int goal_lane,
+                        const OccupancyGrid & occupancy_grid) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  if (primitives.empty()) build();
+
+  stats = LatticeStats();
+  path.clear();
+
+  if (++plan_id_ == 0) {
+
+    fill(stamp_.begin(), stamp_.end(), 0);
+    plan_id_ = 1;
+  }
+
+  nodes_.clear();
+  open_.clear();
+
+  int v_bin = max(0, min(num_speeds - 1, (int) (v / speed(1) + 0.5f)));
+
+  nodes_.push_back({0, s, -1, -1, 0, (unsigned char) lane, (unsigned char) v_bin});
+  open_.push_back(make_pair(heuristic(lane, goal_lane, 0), 0));
+
+  int goal    = -1;
+  int deepest = -1; // fallback when max_expansions is hit first
+
+  while (!open_.empty() && stats.expansions < max_expansions) {
+
+    pop_heap(open_.begin(), open_.end(), greater<pair<float, int>>());
+    int n = open_.back().second;
+    open_.pop_back();
+
+    Node node = nodes_[n];
+
+    if (node.step >= num_steps) {
+
+      goal = n;
+      break;
+    }
+
+    stats.expansions++;
+
+    for (int p = first_primitive[node.v]; p < first_primitive[node.v + 1]; p++) {
+
+      const Primitive & primitive = primitives[p];
+
+      int next_lane = node.lane + primitive.lane_offset;
+
+      if (next_lane < 0 || next_lane >= num_lanes) continue;
+
+      int   next_step = node.step + primitive.steps;
+      float next_s    = node.s + primitive.ds;
+      float g         = node.g + primitive.cost
+                      + w_lane * abs(next_lane - goal_lane) * primitive.steps * step_dt;
+
+      int merged = ((min(next_step, num_steps) * num_lanes + next_lane) * num_speeds + primitive.v1)
+                 * s_bins_ + min(s_bins_ - 1, (int) ((next_s - s) / s_resolution));
+
+      if (stamp_[merged] == plan_id_ && best_g_[merged] <= g) continue;
+
+      if (!collision_free(primitive, node.s, node.lane, node.step * step_dt, occupancy_grid)) continue;
+
+      stamp_[merged]  = plan_id_;
+      best_g_[merged] = g;
+
+      nodes_.push_back({g, next_s, n, p, (unsigned char) next_step,
+                        (unsigned char) next_lane, primitive.v1});
+
+      int pushed = (int) nodes_.size() - 1;
+
+      if (deepest < 0 || next_step > nodes_[deepest].step
+          || (next_step == nodes_[deepest].step && g < nodes_[deepest].g)) deepest = pushed;
+
+      open_.push_back(make_pair(g + heuristic(next_lane, goal_lane, next_step), pushed));
+      push_heap(open_.begin(), open_.end(), greater<pair<float, int>>());
+
+      stats.pushes++;
+    }
+  }
+
+  stats.found = goal >= 0;
+
+  if (goal < 0) goal = deepest;
+
+  for (int n = goal; n >= 0 && nodes_[n].primitive >= 0; n = nodes_[n].parent)
+    path.push_back(nodes_[n].primitive);
+
+  reverse(path.begin(), path.end());
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  stats.elapsed_ms = elapsed.count();
+
+  return path.empty() ? -1 : path[0];
+}
@@ -2,7 +2,10 @@
 #include <math.h>
 #include <uWS/uWS.h>
 #include <chrono>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include "Eigen-3.3/Eigen/Core"
@@ -10,7 +13,19 @@
 #include "json.hpp"
 
 #include "Behavior_planning/spline.h"
+#include "Behavior_planning/alloc_accounting.h"
+#include "Behavior_planning/path_smoother.h"
+#include "Behavior_planning/perf_counters.h"
+#include "Behavior_planning/feasibility.h"
+#include "Behavior_planning/maneuver_templates.h"
 #include "Behavior_planning/road.h"
+#include "Behavior_planning/behavior_scheduler.h"
+#include "Behavior_planning/deadline_scheduler.h"
+#include "Behavior_planning/planner_config.h"
+#include "Behavior_planning/session.h"
+#include "Behavior_planning/shm_transport.h"
+#include "Behavior_planning/stage.h"
+#include "Behavior_planning/telemetry.h"
 #include "Behavior_planning/vehicle.h"
 #include "helper_functions.h"
 
@@ -19,6 +34,27 @@ using namespace std;
 // for convenience
 using json = nlohmann::json;
 
+/*
+ Telemetry of a 42["telemetry",{...}] message, data being its JSON object.
+*/
+static void parse_telemetry(const json & data, Telemetry & telemetry) {
+
+  telemetry.car_x      = data["x"];
+  telemetry.car_y      = data["y"];
+  telemetry.car_s      = data["s"];
+  telemetry.car_d      = data["d"];
+  telemetry.car_yaw    = data["yaw"];
+  telemetry.car_speed  = data["speed"];
+
+  telemetry.previous_path_x = data["previous_path_x"].get<vector<double>>();
+  telemetry.previous_path_y = data["previous_path_y"].get<vector<double>>();
+
+  telemetry.end_path_s = data["end_path_s"];
+  telemetry.end_path_d = data["end_path_d"];
+
+  telemetry.sensor_fusion = data["sensor_fusion"].get<vector<vector<double>>>();
+}
+
 int main() {
 
   uWS::Hub h;
@@ -53,24 +89,125 @@ int main() {
   // s value and lane number of goal.
   vector<int> GOAL        = {(int) max_s, 1};
 
-  Road road = Road(SPEED_LIMIT, LANE_SPEEDS);
+  // picks lane and speed: FSM (Road::behavior_planning), sampled Frenet
+  // trajectories (Road::sampling_planning) or the motion primitive
+  // lattice (Road::lattice_planning)
+  Planner PLANNER         = Planner::FSM;
+
+  // per point speeds from the s-t speed optimizer (Road::speed_planning)
+  // instead of ramping ref_vel toward ego.v
+  bool SPEED_PLANNER      = false;
+
+  // anchors from the lane corridor smoothed reference path (PathSmoother)
+  // instead of the raw getXY points
+  bool SMOOTH_PATH        = false;
+
+  // lane changes follow precomputed lateral templates (ManeuverTemplates)
+  // instead of a spline through anchors in the target lane
+  bool LANE_CHANGE_TEMPLATES = false;
+
+  ManeuverTemplates templates;
+
+  if (LANE_CHANGE_TEMPLATES) templates.build();
+
+  // runs the planner below at most every Session::scheduler.period and
+  // on occupancy changes, path emission keeps running every message
+  bool MULTI_RATE = false;
+
+  // also serve a simulator on this host through shared memory
+  // (ShmTransport), e.g. "/path_planning", "" for WebSocket only
+  std::string SHM_TRANSPORT = "";
+
+  // cycles, instructions and cache and branch misses per planning stage
+  // on every thread running sessions (PerfCounters), in GET /metrics
+  bool PERF_COUNTERS = false;
+
+  // planning workers shared by every connection, earliest deadline first
+  int      PLANNING_WORKERS = 0;   // 0 for the hardware threads
+  Dispatch DISPATCH         = Dispatch::EDF;
+
+  // the values above and the cost.h weights to start with, replaced
+  // at run time by PUT /config and taken over between cycles
+  PlannerConfig initial_config;
+
+  initial_config.speed_limit = SPEED_LIMIT;
+  initial_config.lane_speeds = LANE_SPEEDS;
+  initial_config.max_accel   = MAX_ACCEL;
+  initial_config.goal        = GOAL;
 
-  //configuration data:  target speed, speed limit, num_lanes,
-  //                     goal_s, goal_lane, max_acceleration
-	int num_lanes          = LANE_SPEEDS.size();
-	vector<int> ego_config = {SPEED_LIMIT, num_lanes, GOAL[0],
-		                        GOAL[1], MAX_ACCEL, SPEED_LIMIT};
+  ConfigStore config_store(initial_config);
 
-  //start in lane 1 cause we set lane goal is 1
-  int lane = 1;
-  //have a reference velocity to target
-  double ref_vel = 0.0; //max: 49.5 mph
+  // latest state of every session, a client reconnecting with its
+  // token (ws://host:4567/?session=<token>) resumes from it
+  CheckpointStore checkpoints;
 
-  // start at lane, s = 0 (assume), and configuration: ego_config
-	//road.add_ego(lane, 0, ego_config);
-  road.add_ego(lane, 0, ref_vel, ego_config);
+  checkpoints.directory = "";   // e.g. "/tmp" to survive a planner restart
 
-  h.onMessage([&road, &lane, &ref_vel, &map_waypoints_x, &map_waypoints_y, &map_waypoints_s, &map_waypoints_dx, &map_waypoints_dy]
+  // what the planning cycles of every session read, see Session::plan
+  PlanningContext context(config_store, map_waypoints_s, map_waypoints_x, map_waypoints_y);
+
+  context.checkpoints   = &checkpoints;
+  context.templates     = LANE_CHANGE_TEMPLATES ? &templates : nullptr;
+  context.planner       = PLANNER;
+  context.speed_planner = SPEED_PLANNER;
+  context.smooth_path   = SMOOTH_PATH;
+  context.multi_rate    = MULTI_RATE;
+  context.perf_counters = PERF_COUNTERS;
+
+  // one pool for the sampler and speed planner of every session, a
+  // worker finding it busy runs its loop itself
+  if (PLANNER == Planner::SAMPLING || SPEED_PLANNER) context.pool = make_shared<ThreadPool>();
+
+  // every worker holds a reader slot of config_store, so do the event
+  // loop and the shm thread
+  if (PLANNING_WORKERS <= 0) PLANNING_WORKERS = max(1, (int) thread::hardware_concurrency());
+
+  if (PLANNING_WORKERS + 2 > ConfigStore::max_readers) {
+    PLANNING_WORKERS = ConfigStore::max_readers - 2;
+    std::cout << "Planning workers limited to " << PLANNING_WORKERS << " configuration readers" << std::endl;
+  }
+
+  DeadlineScheduler planner(PLANNING_WORKERS);
+
+  planner.dispatch = DISPATCH;
+
+  // one per connection, see onConnection
+  int next_session = 0;
+
+  // control messages computed on the planning workers, sent from the
+  // event loop by deliver
+  struct Reply {
+
+    uWS::WebSocket<uWS::SERVER> ws;
+
+    shared_ptr<Session>         session;
+
+    string                      msg;
+  };
+
+  mutex         outbox_mutex;
+  vector<Reply> outbox;
+
+  function<void()> deliver = [&outbox_mutex, &outbox]() {
+
+    vector<Reply> replies;
+
+    {
+      lock_guard<mutex> lock(outbox_mutex);
+      replies.swap(outbox);
+    }
+
+    for (Reply & reply : replies)
+      if (reply.session->connected)
+        reply.ws.send(reply.msg.data(), reply.msg.length(), uWS::OpCode::TEXT);
+  };
+
+  uS::Async * wakeup = new uS::Async(h.getLoop());
+
+  wakeup->setData(&deliver);
+  wakeup->start([](uS::Async * async) { (*(function<void()> *) async->getData())(); });
+
+  h.onMessage([&planner, &context, &outbox_mutex, &outbox, wakeup]
               (uWS::WebSocket<uWS::SERVER> ws, char *data, size_t length, uWS::OpCode opCode)
   {
     // "42" at the start of the message means there's a websocket message event.
@@ -78,8 +215,15 @@ int main() {
     // The 2 signifies a websocket event
     //auto sdata = string(data).substr(0, length);
     //cout << sdata << endl;
+    DeadlineScheduler::clock::time_point received = DeadlineScheduler::clock::now();
+
     if (length && length > 2 && data[0] == '4' && data[1] == '2') {
 
+      shared_ptr<Session> session = *(shared_ptr<Session> *) ws.getUserData();
+
+      LedgerScope ledger(session->ledger);
+      StageScope  stage(Stage::PARSE);
+
       auto s = hasData(data);
 
       if (s != "") {
@@ -88,73 +232,40 @@ int main() {
         string event = j[0].get<string>();
 
         if (event == "telemetry") {
-          // j[1] is the data JSON object
-
-        	// Main car's localization Data
-          	double car_x     = j[1]["x"];
-          	double car_y     = j[1]["y"];
-          	double car_s     = j[1]["s"];
-          	double car_d     = j[1]["d"];
-          	double car_yaw   = j[1]["yaw"];
-          	double car_speed = j[1]["speed"];
-
-          	// Previous path data given to the Planner
-          	auto previous_path_x = j[1]["previous_path_x"];
-          	auto previous_path_y = j[1]["previous_path_y"];
-
-            // Previous path's end s and d values
-          	double end_path_s = j[1]["end_path_s"];
-          	double end_path_d = j[1]["end_path_d"];
-
-          	// Sensor Fusion Data, a list of all other cars
-            // on the same side of the road. vector<vector<double>>
-          	auto sensor_fusion = j[1]["sensor_fusion"];
-
-            int prev_size = previous_path_x.size();
-
-            if (prev_size > 0) car_s = end_path_s;
-
-            road.ego_localization(car_s);
-
-            road.add_vehicles_surrounding(sensor_fusion, prev_size);
-
-            road.behavior_planning();
-
-            Vehicle ego = road.get_ego();
 
-            std::cout << " [EGO] state: " << ego.state
-                      << " lane:"  << ego.lane
-                      << " velocity: " << ego.v
-                      << " ego_s: " << ego.s << " car_s: " << car_s
-                      << std::endl;
+          // j[1] is the data JSON object, planned on a worker. The session
+          // runs out of path prev_size * 20 ms after it was received.
+          shared_ptr<Telemetry> telemetry = make_shared<Telemetry>();
 
-            if (car_d < (2 + 4*lane +2) && car_d > (2 + 4*lane -2)) lane = ego.lane;
+          parse_telemetry(j[1], *telemetry);
 
-            if (ref_vel > ego.v)
-               ref_vel -= .224 * 2 ;
+          int prev_size = telemetry->previous_path_x.size();
 
-            else if (ref_vel < ego.v)
-               ref_vel += .224 * 2;
+          // not sent by the simulator, a load generator matches replies by it
+          json seq = j[1].count("seq") ? j[1]["seq"] : json();
 
-            // Create a list of widely spaced (x,y) waypoints, evenly spaced at 30m
-            // Later we will interoplate these waypoints with a spline and
-            // fill it in with more points that control speed
+          planner.submit(session->id, prev_size, received,
+                         [&context, &outbox_mutex, &outbox, wakeup, ws, session, telemetry, seq]() {
 
-            Waypoints wp(prev_size, lane, car_x, car_y, car_yaw, car_s,
-                         map_waypoints_s, map_waypoints_x, map_waypoints_y,
-                         previous_path_x, previous_path_y);
+            Control control = session->plan(*telemetry, context);
 
-            wp.spaced_waypoints_generator ();
-            wp.detailed_waypoints_generator(ref_vel);
+            LedgerScope ledger(session->ledger);
+            StageScope  stage(Stage::SERIALIZE);
 
             json msgJson;
-            msgJson["next_x"] = wp.next_x_vals;
-            msgJson["next_y"] = wp.next_y_vals;
+            msgJson["next_x"] = control.next_x;
+            msgJson["next_y"] = control.next_y;
+            if (!seq.is_null()) msgJson["seq"] = seq;
 
           	auto msg = "42[\"control\","+ msgJson.dump()+"]";
 
-          	//this_thread::sleep_for(chrono::milliseconds(1000));
-          	ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+            {
+              lock_guard<mutex> lock(outbox_mutex);
+              outbox.push_back({ws, session, msg});
+            }
+
+            wakeup->send();
+          });
 
         }
       } else {
@@ -168,10 +279,100 @@ int main() {
   // We don't need this since we're not using HTTP but if it's removed the
   // program doesn't compile :-(
 
-  h.onHttpRequest([](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
-                     size_t, size_t) {
+  h.onHttpRequest([&planner, &config_store, &PERF_COUNTERS](uWS::HttpResponse *res, uWS::HttpRequest req, char *data,
+                     size_t length, size_t remaining) {
     const std::string s = "<h1>Hello world!</h1>";
-    if (req.getUrl().valueLength == 1) {
+    const std::string url(req.getUrl().value, req.getUrl().valueLength);
+    if (url == "/config" && req.getMethod() == uWS::METHOD_PUT) {
+      // fields of the JSON body override the current configuration,
+      // sessions take it over at their next cycle
+      std::string error = remaining > 0 ? "configuration body too large" : "";
+      if (error.empty()) {
+        PlannerConfig config;
+        {
+          ConfigStore::ReadGuard current(config_store);
+          error = PlannerConfig::from_json(std::string(data, length), *current, config);
+        }
+        if (error.empty()) error = config_store.publish(config);
+      }
+      json reply;
+      reply["ok"] = error.empty();
+      if (error.empty()) reply["version"] = config_store.version();
+      else               reply["error"]   = error;
+      std::cout << " [CONFIG] " << (error.empty() ? "published" : "rejected: " + error) << std::endl;
+      const std::string body = reply.dump();
+      res->end(body.data(), body.length());
+    } else if (url == "/config") {
+      ConfigStore::ReadGuard config(config_store);
+      const std::string body = config->to_json();
+      res->end(body.data(), body.length());
+    } else if (url == "/metrics") {
+      // deadline slack of the planning jobs, overall and per session
+      DeadlineStats stats = planner.stats();
+
+      auto histogram = [](const SlackHistogram & slack) {
+        json h;
+        h["jobs"]      = slack.jobs;
+        h["misses"]    = slack.misses;
+        h["min_ms"]    = slack.min_slack;
+        h["mean_ms"]   = slack.jobs > 0 ? slack.sum_slack / slack.jobs : 0;
+        h["p50_ms"]    = slack.quantile(.5);    // upper edges of their bins
+        h["p99_ms"]    = slack.quantile(.99);
+        h["edges_ms"]  = vector<double>(slack.edges, slack.edges + SlackHistogram::bins - 1);
+        h["counts"]    = vector<long>(slack.counts, slack.counts + SlackHistogram::bins);
+        return h;
+      };
+
+      // heap use per stage, with -DALLOC_ACCOUNTING=ON
+      auto allocations = [](const AllocStats & alloc) {
+        json a;
+        for (int i = 0; i < num_stages; i++) {
+          a["stages"][stage_name(static_cast<Stage>(i))]["allocations"] = alloc.allocations[i];
+          a["stages"][stage_name(static_cast<Stage>(i))]["bytes"]       = alloc.bytes[i];
+        }
+        a["live_bytes"]       = alloc.live;
+        a["high_water_bytes"] = alloc.high_water;
+        return a;
+      };
+
+      // where the stages spend their time, with PERF_COUNTERS: low IPC
+      // with many misses per 1000 instructions is memory bound
+      auto counters = [](const PerfStats & perf) {
+        json c;
+        for (int i = 0; i < num_stages; i++) {
+          Stage stage = static_cast<Stage>(i);
+          json & entry = c[stage_name(stage)];
+          entry["time_us"] = perf.time_ns[i] / 1000;
+          for (int e = 0; e < num_perf_events; e++) {
+            PerfEvent event = static_cast<PerfEvent>(e);
+            if (!perf.counted[e]) continue;
+            entry[perf_event_name(event)] = perf.counts[i][e];
+            if (event != PerfEvent::CYCLES && event != PerfEvent::INSTRUCTIONS)
+              entry[std::string(perf_event_name(event)) + "_pki"] = perf.per_kilo_instruction(stage, event);
+          }
+          if (perf.counted[static_cast<int>(PerfEvent::CYCLES)] && perf.counted[static_cast<int>(PerfEvent::INSTRUCTIONS)])
+            entry["ipc"] = perf.ipc(stage);
+        }
+        return c;
+      };
+
+      json metrics;
+      metrics["planner"]["submitted"]  = stats.submitted;
+      metrics["planner"]["completed"]  = stats.completed;
+      metrics["planner"]["superseded"] = stats.superseded;
+      metrics["planner"]["slack"]      = histogram(stats.all);
+      if (AllocAccounting::hooked) metrics["alloc"] = allocations(AllocAccounting::stats(0));
+      if (PERF_COUNTERS) metrics["counters"] = counters(PerfCounters::stats(0));
+      for (auto & session : stats.sessions) {
+        json & entry = metrics["sessions"][to_string(session.first)];
+        entry["slack"] = histogram(session.second);
+        if (AllocAccounting::hooked) entry["alloc"] = allocations(AllocAccounting::stats(session_ledger(session.first)));
+        if (PERF_COUNTERS) entry["counters"] = counters(PerfCounters::stats(session_ledger(session.first)));
+      }
+
+      const std::string body = metrics.dump();
+      res->end(body.data(), body.length());
+    } else if (req.getUrl().valueLength == 1) {
       res->end(s.data(), s.length());
     } else {
       // i guess this should be done more gracefully?
@@ -179,16 +380,102 @@ int main() {
     }
   });
 
-  h.onConnection([&h](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
+  h.onConnection([&h, &next_session, &config_store, &checkpoints, &context, &PERF_COUNTERS]
+                 (uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
+    // the event loop parses the telemetry of every connection
+    if (PERF_COUNTERS) PerfCounters::enable();
+    // planner state of this connection, released in onDisconnection
+    shared_ptr<Session> session;
+    {
+      ConfigStore::ReadGuard config(config_store);
+      PerfCounters::open(next_session);
+      LedgerScope ledger(AllocAccounting::open(next_session));
+      session = make_shared<Session>(next_session++, *config);
+    }
+    // resume a session presenting its token, ?session=<token>
+    const std::string url(req.getUrl().value, req.getUrl().valueLength);
+    const std::string key = "session=";
+    std::string token, blob;
+    size_t found = url.find(key);
+    if (found != std::string::npos) token = url.substr(found + key.size(), url.find('&', found) - found - key.size());
+    if (!token.empty() && checkpoints.get(token, blob)) {
+      auto start = chrono::steady_clock::now();
+      bool resumed = session->restore(blob, context.templates);
+      chrono::duration<double, micro> restore_us = chrono::steady_clock::now() - start;
+      if (resumed) {
+        session->token = token;
+        std::cout << " [SESSION] resumed " << token << " from " << blob.size() << " bytes in "
+                  << restore_us.count() << " us, lane " << session->lane << " at "
+                  << session->ref_vel << " mph" << std::endl;
+      }
+    }
+    if (session->token.empty()) session->token = CheckpointStore::new_token();
+    ws.setUserData(new shared_ptr<Session>(session));
+    std::string msg = "42[\"session\",{\"token\":\"" + session->token + "\"}]";
+    ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
     std::cout << "Connected!!!" << std::endl;
   });
 
-  h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> ws, int code,
-                         char *message, size_t length) {
+  h.onDisconnection([&h, &checkpoints, &planner](uWS::WebSocket<uWS::SERVER> ws, int code,
+                                                 char *message, size_t length) {
+    // a planning job in flight holds its own reference, the checkpoint
+    // of its last finished cycle stays in checkpoints
+    shared_ptr<Session> * session = (shared_ptr<Session> *) ws.getUserData();
+    (*session)->connected = false;
+    // a resumed session gets a new id, nothing more to plan or report for this one
+    planner.forget((*session)->id);
+    checkpoints.persist((*session)->token);
+    delete session;
     ws.close();
     std::cout << "Disconnected" << std::endl;
   });
 
+  // a co-located simulator: the same Session::plan through shared memory rings,
+  // one session for the lifetime of the planner
+  ShmTransport shm;
+
+  if (!SHM_TRANSPORT.empty() && !shm.create(SHM_TRANSPORT)) {
+    std::cerr << "Failed to create shared memory " << SHM_TRANSPORT << std::endl;
+  } else if (!SHM_TRANSPORT.empty()) {
+    shared_ptr<Session> session;
+    {
+      ConfigStore::ReadGuard config(config_store);
+      PerfCounters::open(next_session);
+      LedgerScope ledger(AllocAccounting::open(next_session));
+      session = make_shared<Session>(next_session++, *config);
+    }
+    session->token = CheckpointStore::new_token();
+
+    std::thread([&planner, &context, &shm, &PERF_COUNTERS, session]() {
+      if (PERF_COUNTERS) PerfCounters::enable();
+      TelemetryRecord record;
+      while (true) {
+        if (!shm.receive(record, -1)) continue;
+        DeadlineScheduler::clock::time_point received = DeadlineScheduler::clock::now();
+        shared_ptr<Telemetry> telemetry = make_shared<Telemetry>();
+        {
+          LedgerScope ledger(session->ledger);
+          StageScope  stage(Stage::PARSE);
+          from_record(record, *telemetry);
+        }
+        uint64_t seq = record.seq;
+        planner.submit(session->id, record.prev_size, received, [&context, &shm, session, telemetry, seq]() {
+          ControlRecord reply;
+          Control control = session->plan(*telemetry, context);
+          {
+            LedgerScope ledger(session->ledger);
+            StageScope  stage(Stage::SERIALIZE);
+            to_record(control, seq, reply);
+          }
+          // the simulator side drains every reply, a full ring drops this one
+          shm.send(reply);
+        });
+      }
+    }).detach();
+
+    std::cout << "Serving shared memory " << SHM_TRANSPORT << std::endl;
+  }
+
   int port = 4567;
   if (h.listen(port)) {
     std::cout << "Listening to port " << port << std::endl;
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cmath>
+#include "Behavior_planning/maneuver_templates.h"
+#include "Behavior_planning/feasibility.h"
+
+void ManeuverTemplates::build() {
+
+  num_durations = (int) ((max_duration - min_duration) / duration_step + 0.5) + 1;
+  max_steps     = (int) (max_duration / dt + 0.5) + 1;
+
+  int templates = speed_bins * num_durations;
+
+  steps.assign(templates, 0);
+  feasible.assign(templates, 0);
+  lateral.assign(templates * max_steps, 1.0f);
+  advance.assign(templates * max_steps, 1.0f);
+
+  FeasibilityChecker checker;
+
+  checker.dt     = dt;
+  checker.window = 1;
+
+  vector<double> x(max_steps), y(max_steps);
+
+  for (int id = 0; id < templates; id++) {
+
+    double v    = speed(id);
+    int    K    = (int) (duration(id) / dt + 0.5);
+    double step = v * dt;
+
+    float * p = &lateral[id * max_steps];
+    float * a = &advance[id * max_steps];
+
+    x.resize(K + 1);
+    y.resize(K + 1);
+
+    x[0] = y[0] = 0;
+    p[0] = 0;
+
+    for (int k = 1; k <= K; k++) {
+
+      double tau = (double) k / K;
+
+      p[k] = (float) (tau * tau * tau * (10 - 15 * tau + 6 * tau * tau));
+
+      double dy = lane_width * (p[k] - p[k-1]);
+      double dx = sqrt(max(0.0, step * step - dy * dy));
+
+      a[k] = (float) (dx / step);
+
+      x[k] = x[k-1] + dx;
+      y[k] = y[k-1] + dy;
+    }
+
+    steps[id]    = K + 1;
+    feasible[id] = checker.check(x, y) < 0;
+  }
+}
+
+float ManeuverTemplates::speed(int id) const {
+
+  int bin = id / num_durations;
+
+  return speed_bins > 1 ? min_speed + (max_speed - min_speed) * bin / (speed_bins - 1) : max_speed;
+}
+
+float ManeuverTemplates::duration(int id) const {
+
+  return min_duration + duration_step * (id % num_durations);
+}
+
+int ManeuverTemplates::select(float v) const {
+
+  float f   = speed_bins > 1 ? (v - min_speed) / (max_speed - min_speed) * (speed_bins - 1) : 0;
+  int   bin = max(0, min(speed_bins - 1, (int) (f + 0.5f)));
+
+  int first = bin * num_durations;
+
+  for (int id = first; id < first + num_durations; id++)
+    if (feasible[id]) return id;
+
+  // nothing within the limits, the gentlest one
+  return first + num_durations - 1;
+}
+
+float ManeuverTemplates::lateral_at(int id, int step) const {
+
+  return lateral[id * max_steps + min(step, max_steps - 1)];
+}
+
+float ManeuverTemplates::advance_at(int id, int step) const {
+
+  return advance[id * max_steps + min(step, max_steps - 1)];
+}
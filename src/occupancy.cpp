@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cmath>
+#include "Behavior_planning/occupancy.h"
+
+/*
+   Bits b0..b1 of word w, 0 <= b0 <= b1 < 64.
+*/
+static inline uint64_t bit_mask(int b0, int b1) {
+
+  uint64_t high = (b1 == 63) ? ~0ULL : ((1ULL << (b1 + 1)) - 1);
+  return high & (~0ULL << b0);
+}
+
+void OccupancyGrid::resize(int steps, float dt) {
+
+  int num_bins      = (int) ceil(max_s / bin_size);
+  int words_per_row = (num_bins + 63) / 64;
+
+  if (steps != this->steps || num_bins != this->num_bins
+      || words_per_row * steps * num_lanes != (int) words.size()) {
+
+    this->steps         = steps;
+    this->num_bins      = num_bins;
+    this->words_per_row = words_per_row;
+
+    words.assign(steps * num_lanes * words_per_row, 0);
+    dirty_.clear();
+  }
+
+  this->dt = dt;
+}
+
+/*
+   Bin range [b0, b1] covering s0..s1, b0 in [0, num_bins) and
+   b0 <= b1 < b0 + num_bins, so b1 may run past the seam.
+*/
+void OccupancyGrid::bin_range(float s0, float s1, int & b0, int & b1) const {
+
+  float length = min(s1 - s0, max_s - bin_size);
+
+  s0 = fmod(s0, max_s);
+  if (s0 < 0) s0 += max_s;
+
+  b0 = min((int) (s0 / bin_size), num_bins - 1);
+  b1 = (int) ((s0 + length) / bin_size);
+}
+
+void OccupancyGrid::set_bins(int row, int b0, int b1) {
+
+  uint64_t * row_words = &words[row * words_per_row];
+
+  if (b1 >= num_bins) {
+
+    set_bins(row, 0, b1 - num_bins);
+    b1 = num_bins - 1;
+  }
+
+  for (int w = b0 >> 6; w <= (b1 >> 6); w++) {
+
+    int lo = (w == (b0 >> 6)) ? (b0 & 63) : 0;
+    int hi = (w == (b1 >> 6)) ? (b1 & 63) : 63;
+
+    if (row_words[w] == 0) dirty_.push_back(row * words_per_row + w);
+
+    row_words[w] |= bit_mask(lo, hi);
+  }
+}
+
+bool OccupancyGrid::any_bins(int row, int b0, int b1) const {
+
+  const uint64_t * row_words = &words[row * words_per_row];
+
+  if (b1 >= num_bins) {
+
+    if (any_bins(row, 0, b1 - num_bins)) return true;
+    b1 = num_bins - 1;
+  }
+
+  uint64_t any = 0;
+
+  for (int w = b0 >> 6; w <= (b1 >> 6); w++) {
+
+    int lo = (w == (b0 >> 6)) ? (b0 & 63) : 0;
+    int hi = (w == (b1 >> 6)) ? (b1 & 63) : 63;
+
+    any |= row_words[w] & bit_mask(lo, hi);
+  }
+
+  return any != 0;
+}
+
+/*
+   Replaces the occupancy with the footprints of a new rollout.
+*/
+void OccupancyGrid::update(const Prediction & prediction) {
+
+  this->num_lanes = prediction.num_lanes;
+
+  resize(prediction.steps, prediction.dt);
+
+  for (int w : dirty_) words[w] = 0;
+  dirty_.clear();
+
+  // words a footprint can set in its lane and one neighbor, so dirty_
+  // grows only with the most vehicles ever predicted
+  int footprint_words = 2 * ((int) ceil(vehicle_length / bin_size) / 64 + 2);
+
+  dirty_.reserve(footprint_words * steps * prediction.size);
+
+  float half_length = 0.5 * vehicle_length;
+
+  for (int k = 0; k < steps; k++) {
+
+    const float * s = prediction.s_row(k);
+    const float * d = prediction.d_row(k);
+
+    for (int i = 0; i < prediction.size; i++) {
+
+      int lane = (int) (d[i] / lane_width);
+
+      if (lane < 0 || lane >= num_lanes) continue;
+
+      int b0, b1;
+      bin_range(s[i] - half_length, s[i] + half_length, b0, b1);
+
+      set_bins(k * num_lanes + lane, b0, b1);
+
+      float offset = d[i] - (lane + 0.5f) * lane_width;
+
+      if (offset >  straddle && lane + 1 < num_lanes) set_bins(k * num_lanes + lane + 1, b0, b1);
+      if (offset < -straddle && lane > 0)             set_bins(k * num_lanes + lane - 1, b0, b1);
+    }
+  }
+}
+
+/*
+   True if no predicted vehicle occupies lane over s0..s1 at any
+   time step in t0..t1 [s].
+*/
+bool OccupancyGrid::lane_free(int lane, float s0, float s1, float t0, float t1) const {
+
+  if (lane < 0 || lane >= num_lanes || steps == 0) return true;
+
+  int k0 = max(0, (int) floor(t0 / dt));
+  int k1 = min(steps - 1, (int) ceil(t1 / dt));
+
+  int b0, b1;
+  bin_range(s0, s1, b0, b1);
+
+  for (int k = k0; k <= k1; k++) {
+
+    if (any_bins(k * num_lanes + lane, b0, b1)) return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "Behavior_planning/path_smoother.h"
+
+static const double SECOND_DIFFERENCE[] = { 1, -2,  1};
+static const double THIRD_DIFFERENCE[]  = {-1,  3, -3, 1};
+
+/*
+   Lower band pattern of the Hessian of n nodes and its symbolic
+   factorization. smooth() only rewrites the values.
+*/
+void PathSmoother::analyze(int n) {
+
+  vector<Eigen::Triplet<double>> band;
+
+  for (int j = 0; j < n; j++)
+    for (int i = j; i < min(n, j + 4); i++)
+      band.push_back(Eigen::Triplet<double>(i, j, i == j ? 1 : 0));
+
+  H_.resize(n, n);
+  H_.setFromTriplets(band.begin(), band.end());
+  H_.makeCompressed();
+
+  solver_.analyzePattern(H_);
+
+  rhs_.resize(n);
+  l_.resize(n);
+
+  difference_.resize(H_.nonZeros());
+  gradient_.resize(n);
+  penalty_.resize(n);
+  bound_.resize(n);
+
+  n_ = n;
+}
+
+/*
+   Adds the lateral part of difference k, over nodes k to k + order
+   with coefficients d, to the difference Hessian and gradient.
+*/
+void PathSmoother::accumulate(int k, int order, double w, const double * d) {
+
+  // normal at the middle of the difference
+  double cx = order == 2 ? normal_x[k+1] : 0.5 * (normal_x[k+1] + normal_x[k+2]);
+  double cy = order == 2 ? normal_y[k+1] : 0.5 * (normal_y[k+1] + normal_y[k+2]);
+
+  double a[4];
+  double r = 0;
+
+  for (int m = 0; m <= order; m++) {
+
+    a[m] = d[m] * (cx * normal_x[k+m] + cy * normal_y[k+m]);
+
+    // relative to node k, the coefficients sum to 0
+    r += d[m] * (cx * (ref_x[k+m] - ref_x[k]) + cy * (ref_y[k+m] - ref_y[k]));
+  }
+
+  const int * outer = H_.outerIndexPtr();
+
+  for (int m2 = 0; m2 <= order; m2++) {
+
+    int j = k + m2;
+
+    for (int m1 = m2; m1 <= order; m1++)
+      difference_[outer[j] + m1 - m2] += w * a[m1] * a[m2];
+
+    gradient_[j] += w * a[m2] * r;
+  }
+}
+
+void PathSmoother::smooth() {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  int n = ref_x.size();
+
+  stats       = SmootherStats();
+  stats.nodes = n;
+
+  offset.assign(n, 0);
+  x.assign(ref_x.begin(), ref_x.end());
+  y.assign(ref_y.begin(), ref_y.end());
+
+  if (n < 4) return;
+
+  if (n != n_) {
+
+    analyze(n);
+    stats.analyzed = true;
+  }
+
+  double h2 = spacing * spacing;
+  double w2 = w_d2 / (h2 * h2);
+  double w3 = w_d3 / (h2 * h2 * h2);
+
+  fill(difference_.begin(), difference_.end(), 0.0);
+  fill(gradient_.begin(), gradient_.end(), 0.0);
+
+  for (int k = 0; k + 2 < n; k++) accumulate(k, 2, w2, SECOND_DIFFERENCE);
+  for (int k = 0; k + 3 < n; k++) accumulate(k, 3, w3, THIRD_DIFFERENCE);
+
+  fill(penalty_.begin(), penalty_.end(), 0.0);
+
+  const int * outer = H_.outerIndexPtr();
+  double *    h     = H_.valuePtr();
+
+  bool solved = false;
+
+  while (stats.iterations < max_iterations) {
+
+    copy(difference_.begin(), difference_.end(), h);
+
+    // the diagonal leads every column
+    for (int i = 0; i < n; i++) {
+
+      h[outer[i]] += w_ref + penalty_[i];
+      rhs_[i]      = penalty_[i] * bound_[i] - gradient_[i];
+    }
+
+    solver_.factorize(H_);
+    stats.iterations++;
+
+    if (solver_.info() != Eigen::Success) break;
+
+    l_     = solver_.solve(rhs_);
+    solved = true;
+
+    int added = 0;
+
+    for (int i = 0; i < n; i++) {
+
+      if (penalty_[i] > 0) continue;
+
+      if (l_[i] < lower[i] || l_[i] > upper[i]) {
+
+        penalty_[i] = w_bound;
+        bound_[i]   = l_[i] < lower[i] ? lower[i] : upper[i];
+        added++;
+      }
+    }
+
+    if (added == 0) break;
+  }
+
+  if (solved) {
+
+    for (int i = 0; i < n; i++) {
+
+      offset[i] = max(lower[i], min(upper[i], l_[i]));
+
+      x[i] = ref_x[i] + normal_x[i] * offset[i];
+      y[i] = ref_y[i] + normal_y[i] * offset[i];
+
+      if (penalty_[i] > 0) stats.active++;
+    }
+  }
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  stats.elapsed_ms = elapsed.count();
+}
@@ -0,0 +1,198 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#include "Behavior_planning/perf_counters.h"
+
+struct PerfLedger {
+
+  atomic<long> time_ns[num_stages];
+
+  atomic<long> counts[num_stages][num_perf_events];
+};
+
+static PerfLedger ledgers[max_ledgers + 1];
+
+// events some thread opened
+static atomic<bool> counted[num_perf_events];
+
+const char * perf_event_name(PerfEvent event) {
+
+  static const char * const names[num_perf_events] = {"cycles", "instructions", "l1d_misses",
+                                                      "llc_misses", "branch_misses"};
+
+  return names[static_cast<int>(event)];
+}
+
+long PerfStats::count(Stage stage, PerfEvent event) const {
+
+  return counts[static_cast<int>(stage)][static_cast<int>(event)];
+}
+
+double PerfStats::ipc(Stage stage) const {
+
+  long cycles = count(stage, PerfEvent::CYCLES);
+
+  return cycles > 0 ? (double) count(stage, PerfEvent::INSTRUCTIONS) / cycles : 0;
+}
+
+double PerfStats::per_kilo_instruction(Stage stage, PerfEvent event) const {
+
+  long instructions = count(stage, PerfEvent::INSTRUCTIONS);
+
+  return instructions > 0 ? 1000.0 * count(stage, event) / instructions : 0;
+}
+
+static long now_ns() {
+
+  return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PerfCounters::PerfCounters() : last_ns_(now_ns()) {
+
+  for (int i = 0; i < num_perf_events; i++) fds_[i] = slots_[i] = -1;
+
+#ifdef __linux__
+  static const struct { uint32_t type; uint64_t config; } events[num_perf_events] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL  | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+  };
+
+  for (int i = 0; i < num_perf_events; i++) {
+
+    perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = events[i].type;
+    attr.config         = events[i].config;
+    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled       = group_ < 0;      // the leader starts the whole group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    // the calling thread on any CPU, an event the CPU lacks is left out
+    fds_[i] = syscall(SYS_perf_event_open, &attr, 0, -1, group_, 0);
+
+    if (fds_[i] < 0) continue;
+
+    if (group_ < 0) group_ = fds_[i];
+
+    slots_[i] = opened_++;
+    counted[i].store(true, memory_order_relaxed);
+  }
+
+  if (group_ >= 0) ioctl(group_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+
+  if (stage_observer == this) stage_observer = nullptr;
+
+  for (int i = 0; i < num_perf_events; i++) if (fds_[i] >= 0) close(fds_[i]);
+}
+
+bool PerfCounters::enable() {
+
+  static thread_local PerfCounters counters;
+
+  stage_observer = &counters;
+
+  return counters.group_ >= 0;
+}
+
+void PerfCounters::open(int session) {
+
+  PerfLedger & l = ledgers[session_ledger(session)];
+
+  for (int s = 0; s < num_stages; s++) {
+
+    l.time_ns[s].store(0, memory_order_relaxed);
+
+    for (int e = 0; e < num_perf_events; e++) l.counts[s][e].store(0, memory_order_relaxed);
+  }
+}
+
+PerfStats PerfCounters::stats(int ledger) {
+
+  const PerfLedger & l = ledgers[ledger];
+
+  PerfStats stats;
+
+  for (int e = 0; e < num_perf_events; e++) stats.counted[e] = counted[e].load(memory_order_relaxed);
+
+  for (int s = 0; s < num_stages; s++) {
+
+    stats.time_ns[s] = l.time_ns[s].load(memory_order_relaxed);
+
+    for (int e = 0; e < num_perf_events; e++) stats.counts[s][e] = l.counts[s][e].load(memory_order_relaxed);
+  }
+  return stats;
+}
+
+static void charge(PerfLedger & l, int stage, long ns, const long * counts) {
+
+  l.time_ns[stage].fetch_add(ns, memory_order_relaxed);
+
+  if (counts) for (int e = 0; e < num_perf_events; e++) l.counts[stage][e].fetch_add(counts[e], memory_order_relaxed);
+}
+
+// outside every ledger and stage, e.g. a worker waiting for jobs, is not charged
+static void charge(int ledger, int stage, long ns, const long * counts) {
+
+  if (ledger == 0 && stage == static_cast<int>(Stage::OTHER)) return;
+
+  charge(ledgers[0], stage, ns, counts);
+
+  if (ledger > 0) charge(ledgers[ledger], stage, ns, counts);
+}
+
+void PerfCounters::sample() {
+
+  int stage = static_cast<int>(stage_tag);
+
+  long now = now_ns();
+  long ns  = now - last_ns_;
+
+  last_ns_ = now;
+
+  // nr, time enabled, time running, then the values in opening order
+  uint64_t group[3 + num_perf_events];
+
+  if (group_ < 0 || read(group_, group, sizeof(group)) < (ssize_t) ((3 + opened_) * sizeof(uint64_t))) {
+
+    charge(ledger_tag, stage, ns, nullptr);
+    return;
+  }
+
+  uint64_t enabled = group[1] - last_enabled_;
+  uint64_t running = group[2] - last_running_;
+
+  last_enabled_ = group[1];
+  last_running_ = group[2];
+
+  double scale = running > 0 ? (double) enabled / running : 0;
+
+  long counts[num_perf_events] = {};
+
+  for (int e = 0; e < num_perf_events; e++) {
+
+    if (slots_[e] < 0) continue;
+
+    uint64_t value = group[3 + slots_[e]];
+
+    counts[e] = (long) ((value - last_[e]) * scale);
+    last_[e]  = value;
+  }
+
+  charge(ledger_tag, stage, ns, counts);
+}
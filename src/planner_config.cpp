@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "Behavior_planning/planner_config.h"
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+vector<int> PlannerConfig::ego_config() const {
+
+  return {speed_limit, (int) lane_speeds.size(), goal[0], goal[1], max_accel, speed_limit};
+}
+
+string PlannerConfig::validate() const {
+
+  if (speed_limit <= 0 || speed_limit > 50) return "speed_limit must be in (0, 50] mph";
+
+  if (lane_speeds.empty() || lane_speeds.size() > 8) return "lane_speeds must list 1 to 8 lanes";
+
+  for (int speed : lane_speeds)
+    if (speed <= 0) return "lane_speeds must be > 0";
+
+  if (max_accel <= 0 || max_accel > 10) return "max_accel must be in (0, 10] m/s^2";
+
+  if (goal.size() != 2 || goal[0] <= 0) return "goal must be [s > 0, lane]";
+
+  if (goal[1] < 0 || goal[1] >= (int) lane_speeds.size()) return "goal lane out of the road";
+
+  if (preferred_buffer < 0 || preferred_buffer > 200) return "preferred_buffer must be in [0, 200] m";
+
+  const float weights_in_use[] = {weights.reach_goal, weights.efficiency, weights.max_accelerate,
+                                  weights.max_speed, weights.lane_change, weights.off_road,
+                                  weights.center_lane};
+
+  for (float weight : weights_in_use)
+    if (!std::isfinite(weight) || weight < 0) return "cost weights must be finite and >= 0";
+
+  return "";
+}
+
+string PlannerConfig::to_json() const {
+
+  json config;
+
+  config["version"]          = version;
+  config["speed_limit"]      = speed_limit;
+  config["lane_speeds"]      = lane_speeds;
+  config["max_accel"]        = max_accel;
+  config["goal"]             = goal;
+  config["preferred_buffer"] = preferred_buffer;
+
+  config["weights"]["reach_goal"]     = weights.reach_goal;
+  config["weights"]["efficiency"]     = weights.efficiency;
+  config["weights"]["max_accelerate"] = weights.max_accelerate;
+  config["weights"]["max_speed"]      = weights.max_speed;
+  config["weights"]["lane_change"]    = weights.lane_change;
+  config["weights"]["off_road"]       = weights.off_road;
+  config["weights"]["center_lane"]    = weights.center_lane;
+
+  return config.dump();
+}
+
+string PlannerConfig::from_json(const string & body, const PlannerConfig & base,
+                                PlannerConfig & config) {
+
+  config = base;
+
+  try {
+
+    json update = json::parse(body);
+
+    if (!update.is_object()) return "expected a JSON object";
+
+    for (auto field = update.begin(); field != update.end(); ++field) {
+
+      const string & key = field.key();
+
+      if      (key == "speed_limit")      config.speed_limit      = field.value().get<int>();
+      else if (key == "lane_speeds")      config.lane_speeds      = field.value().get<vector<int>>();
+      else if (key == "max_accel")        config.max_accel        = field.value().get<int>();
+      else if (key == "goal")             config.goal             = field.value().get<vector<int>>();
+      else if (key == "preferred_buffer") config.preferred_buffer = field.value().get<int>();
+      else if (key == "weights") {
+
+        for (auto weight = field.value().begin(); weight != field.value().end(); ++weight) {
+
+          const string & name  = weight.key();
+          float          value = weight.value().get<float>();
+
+          if      (name == "reach_goal")     config.weights.reach_goal     = value;
+          else if (name == "efficiency")     config.weights.efficiency     = value;
+          else if (name == "max_accelerate") config.weights.max_accelerate = value;
+          else if (name == "max_speed")      config.weights.max_speed      = value;
+          else if (name == "lane_change")    config.weights.lane_change    = value;
+          else if (name == "off_road")       config.weights.off_road       = value;
+          else if (name == "center_lane")    config.weights.center_lane    = value;
+          else return "unknown weight " + name;
+        }
+      }
+      else if (key != "version") return "unknown field " + key;
+    }
+
+  } catch (const exception & e) {
+
+    return e.what();
+  }
+
+  return "";
+}
+
+// reader slots held by live threads, the same index in every store
+static atomic<bool> slot_taken[ConfigStore::max_readers];
+
+/*
+ Reader slot of a thread, taken on its first ReadGuard and given back
+ when it exits, so threads coming and going do not use slots up.
+*/
+struct ReaderSlot {
+
+  int index = -1;
+
+  ReaderSlot() {
+
+    for (int i = 0; i < ConfigStore::max_readers && index < 0; i++) {
+
+      bool taken = false;
+
+      if (slot_taken[i].compare_exchange_strong(taken, true)) index = i;
+    }
+  }
+
+  ~ReaderSlot() { if (index >= 0) slot_taken[index].store(false); }
+};
+
+/**
+ * Initializes ConfigStore
+ */
+ConfigStore::ConfigStore(const PlannerConfig & initial) : current_(new PlannerConfig(initial)), epoch_(1) {
+
+  for (atomic<uint64_t> & reader : readers_) reader.store(0);
+}
+
+ConfigStore::~ConfigStore() {
+
+  for (auto & retired : retired_) delete retired.second;
+
+  delete current_.load();
+}
+
+atomic<uint64_t> * ConfigStore::slot() const {
+
+  static thread_local ReaderSlot reader;
+
+  if (reader.index < 0) throw runtime_error("ConfigStore: too many reader threads");
+
+  return &readers_[reader.index];
+}
+
+ConfigStore::ReadGuard::ReadGuard(const ConfigStore & store) : slot_(store.slot()) {
+
+  // announced before the load, a publish after it sees this reader
+  slot_->store(store.epoch_.load());
+
+  config_ = store.current_.load();
+}
+
+ConfigStore::ReadGuard::~ReadGuard() {
+
+  slot_->store(0, memory_order_release);
+}
+
+string ConfigStore::publish(const PlannerConfig & config) {
+
+  string error = config.validate();
+
+  if (!error.empty()) return error;
+
+  lock_guard<mutex> lock(publish_mutex_);
+
+  const PlannerConfig * current = current_.load();
+
+  // Road, prediction and lattice are sized for the lanes at startup
+  if (config.lane_speeds.size() != current->lane_speeds.size())
+    return "the number of lanes can not change at run time";
+
+  PlannerConfig * next = new PlannerConfig(config);
+
+  next->version = current->version + 1;
+
+  current_.store(next);
+
+  // readers announcing this epoch or earlier may still hold current
+  retired_.push_back(make_pair(epoch_.fetch_add(1), current));
+
+  reclaim();
+
+  return "";
+}
+
+long ConfigStore::version() const {
+
+  ReadGuard config(*this);
+  return config->version;
+}
+
+int ConfigStore::retired() const {
+
+  lock_guard<mutex> lock(publish_mutex_);
+  return (int) retired_.size();
+}
+
+void ConfigStore::reclaim() {
+
+  uint64_t oldest = UINT64_MAX;
+
+  for (const atomic<uint64_t> & reader : readers_) {
+
+    uint64_t epoch = reader.load();
+
+    if (epoch != 0 && epoch < oldest) oldest = epoch;
+  }
+
+  auto last = remove_if(retired_.begin(), retired_.end(),
+                        [oldest](const pair<uint64_t, const PlannerConfig *> & retired) {
+
+    if (retired.first >= oldest) return false;
+
+    delete retired.second;
+    return true;
+  });
+
+  retired_.erase(last, retired_.end());
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cmath>
+#include "Behavior_planning/prediction.h"
+
+/**
+ * Initializes Prediction
+ */
+Prediction::Prediction(float horizon, float dt) {
+
+  configure(horizon, dt);
+}
+
+void Prediction::configure(float horizon, float dt) {
+
+  this->horizon = horizon;
+  this->dt      = dt;
+  this->steps   = (int) (horizon / dt + 0.5) + 1;
+}
+
+void Prediction::clear() {
+
+  this->size = 0;
+}
+
+/*
+   Adds a vehicle to the next rollout. Storage grows only when more
+   vehicles than ever before are tracked.
+*/
+void Prediction::add(int id, float s, float d, float v, float a, float d_dot) {
+
+  if (this->size == (int) this->s0.size()) {
+
+    this->id.push_back(id);
+    this->s0.push_back(s);
+    this->d0.push_back(d);
+    this->v0.push_back(v);
+    this->a0.push_back(a);
+    this->d_dot0.push_back(d_dot);
+
+  } else {
+
+    this->id[size]     = id;
+    this->s0[size]     = s;
+    this->d0[size]     = d;
+    this->v0[size]     = v;
+    this->a0[size]     = a;
+    this->d_dot0[size] = d_dot;
+  }
+
+  this->size++;
+}
+
+/*
+   One time step of the rollout, written as a flat loop over vehicles
+   so the compiler vectorizes it.
+*/
+static void rollout_step(float t, int n,
+                         const float * __restrict__ s_in,
+                         const float * __restrict__ d_in,
+                         const float * __restrict__ v_in,
+                         const float * __restrict__ a_in,
+                         const float * __restrict__ t_stop,
+                         const float * __restrict__ d_dot,
+                         const float * __restrict__ d_min,
+                         const float * __restrict__ d_max,
+                         float * __restrict__ s_out,
+                         float * __restrict__ d_out,
+                         float * __restrict__ v_out)
+{
+
+  for (int i = 0; i < n; i++) {
+
+    float t_move = t < t_stop[i] ? t : t_stop[i];
+    float d_free = d_in[i] + d_dot[i] * t;
+
+    d_free   = d_free > d_min[i] ? d_free : d_min[i];
+    d_free   = d_free < d_max[i] ? d_free : d_max[i];
+
+    s_out[i] = s_in[i] + v_in[i] * t_move + 0.5f * a_in[i] * t_move * t_move;
+    v_out[i] = v_in[i] + a_in[i] * t_move;
+    d_out[i] = d_free;
+  }
+}
+
+/*
+   Rolls out all vehicles over the horizon.
+
+   Longitudinal: constant velocity, or constant acceleration where a
+   decelerating vehicle stops at v = 0 instead of driving backwards.
+
+   Lateral: a vehicle with |d_dot| above lane_change_d_dot moves at d_dot
+   until it reaches the center of the neighbor lane, any other vehicle
+   keeps its d.
+*/
+void Prediction::rollout(Model model) {
+
+  this->stride = (this->size + 7) & ~7;
+
+  int n = this->stride;
+
+  // zero the padding so the vector loops below stay branch free
+  for (vector<float> * in : {&s0, &d0, &v0, &a0, &d_dot0}) {
+
+    if ((int) in->size() < n) in->resize(n);
+    fill(in->begin() + this->size, in->begin() + n, 0.0f);
+  }
+
+  a_.resize(n);
+  t_stop_.resize(n);
+  d_dot_.resize(n);
+  d_min_.resize(n);
+  d_max_.resize(n);
+
+  for (int i = 0; i < n; i++) {
+
+    float a = (model == CONSTANT_ACCELERATION) ? a0[i] : 0.0f;
+
+    a_[i]      = a;
+    t_stop_[i] = (a < 0) ? -v0[i] / a : horizon;
+
+    int   lane   = (int) (d0[i] / lane_width);
+    float d_dot  = d_dot0[i];
+
+    if (d_dot > lane_change_d_dot && lane < num_lanes - 1) {
+
+      d_dot_[i] = d_dot;
+      d_min_[i] = d0[i];
+      d_max_[i] = max(d0[i], (lane + 1.5f) * lane_width);
+
+    } else if (d_dot < -lane_change_d_dot && lane > 0) {
+
+      d_dot_[i] = d_dot;
+      d_min_[i] = min(d0[i], (lane - 0.5f) * lane_width);
+      d_max_[i] = d0[i];
+
+    } else {
+
+      d_dot_[i] = 0;
+      d_min_[i] = d0[i];
+      d_max_[i] = d0[i];
+    }
+  }
+
+  if ((int) this->s.size() < this->steps * n) {
+
+    this->s.resize(this->steps * n);
+    this->d.resize(this->steps * n);
+    this->v.resize(this->steps * n);
+  }
+
+  for (int k = 0; k < this->steps; k++) {
+
+    rollout_step(k * this->dt, n, s0.data(), d0.data(), v0.data(), a_.data(),
+                 t_stop_.data(), d_dot_.data(), d_min_.data(), d_max_.data(),
+                 &this->s[k * n], &this->d[k * n], &this->v[k * n]);
+  }
+}
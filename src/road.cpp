@@ -4,6 +4,7 @@
 #include <string>
 #include <iterator>
 #include "Behavior_planning/road.h"
+#include "Behavior_planning/stage.h"
 #include "Behavior_planning/vehicle.h"
 
 
@@ -16,63 +17,144 @@ Road::Road(int speed_limit, vector<int> lane_speeds) {
     this->lane_speeds   = lane_speeds;
     this->speed_limit   = speed_limit;
 
+    this->prediction.num_lanes = this->num_lanes;
+
+    this->lattice.num_lanes = this->num_lanes;
+    this->lattice.max_speed = speed_limit / 2.24;
+    this->lattice.build();
+
 }
 
 Road::~Road() {}
 
 Vehicle Road::get_ego() {
 
-	return this->vehicles.find(this->ego_key)->second;
+	return this->ego;
 }
 
 void Road::ego_localization(double s){
 
-  Vehicle &ego = this->vehicles.find(this->ego_key)->second;
-
-  ego.s = (int) s;
+  this->ego.s = (int) s;
 
 }
 
 void Road::behavior_planning() {
 
-  // generate predictions for surrounding vehicles in horizon
-  map<int ,vector<Vehicle>> predictions;
+  {
+    StageScope stage(Stage::PREDICTION);
 
-	map<int, Vehicle>::iterator it = this->vehicles.begin();
+    this->prediction.rollout();
 
-  while(it != this->vehicles.end())
-  {
+    this->collision_checker.build(this->prediction);
 
-    int v_id              = it->first;
+    this->occupancy_grid.update(this->prediction);
 
-    vector<Vehicle> preds = it->second.generate_predictions();
+    // generate predictions for surrounding vehicles in horizon
+    for (int id = 0; id < (int) this->tracks.size(); id++)
+    {
 
-    predictions[v_id]     = preds;
+      Track &track = this->tracks[id];
 
-    it++;
+      if (track.active) track.vehicle.generate_predictions(this->predictions[id]);
+    }
+
+    this->lane_features.update(this->ego, this->predictions, &this->occupancy_grid);
   }
 
   //Update Ego
-  it = this->vehicles.begin();
+  this->ego.collision_checker = &this->collision_checker;
+  this->ego.occupancy_grid    = &this->occupancy_grid;
+  this->ego.lane_features     = &this->lane_features;
+  this->ego.cost_weights      = &this->cost_weights;
+
+  Trajectory trajectory
+  = this->ego.choose_next_state(this->predictions, &this->cost_stats);
+
+  this->ego.realize_next_state(trajectory);
+
+}
+
+/*
+   Alternative to behavior_planning: the best candidate of the
+   FrenetSampler, started from the ego s, speed [mph] and d, sets the
+   ego lane and target speed.
+*/
+void Road::sampling_planning(double speed, double d) {
 
-  while(it != this->vehicles.end())
   {
+    StageScope stage(Stage::PREDICTION);
+    this->prediction.rollout();
+  }
 
-    int v_id = it->first;
+  StageScope stage(Stage::CANDIDATES);
 
-    if(v_id == ego_key)
-    {
+  this->sampler.num_lanes = this->num_lanes;
+  this->sampler.max_speed = this->speed_limit / 2.24;
 
-      vector<Vehicle> trajectory
-      = it->second.choose_next_state(predictions);
+  int best = this->sampler.plan(this->ego.s, speed / 2.24, 0, d, this->ego.goal_lane, this->prediction);
 
-      it->second.realize_next_state(trajectory);
+  if (best < 0) return;
 
-    }
-    it++;
+  int lane = this->sampler.lane[best];
+
+  if      (lane < this->ego.lane) this->ego.state = State::LCL;
+  else if (lane > this->ego.lane) this->ego.state = State::LCR;
+  else                            this->ego.state = State::KL;
+
+  this->ego.lane = lane;
+  this->ego.v    = this->sampler.v1[best] * 2.24;
+}
+
+/*
+   Alternative to behavior_planning: the first primitive of the best
+   lattice path from the ego s, speed [mph] and lane sets the ego lane
+   and target speed. Falls back to the FSM when no path is free.
+*/
+void Road::lattice_planning(double speed) {
+
+  {
+    StageScope stage(Stage::PREDICTION);
+
+    this->prediction.rollout();
+
+    this->occupancy_grid.update(this->prediction);
+  }
+
+  int first;
+  {
+    StageScope stage(Stage::CANDIDATES);
+
+    first = this->lattice.plan(this->ego.s, speed / 2.24, this->ego.lane, this->ego.goal_lane,
+                               this->occupancy_grid);
+  }
 
+  if (first < 0) {
+
+    behavior_planning();
+    return;
   }
 
+  const Primitive & primitive = this->lattice.primitives[first];
+
+  if      (primitive.lane_offset < 0) this->ego.state = State::LCL;
+  else if (primitive.lane_offset > 0) this->ego.state = State::LCR;
+  else                                this->ego.state = State::KL;
+
+  this->ego.lane += primitive.lane_offset;
+  this->ego.v     = this->lattice.speed(primitive.v1) * 2.24;
+}
+
+/*
+   Speed profile in the ego lane toward the ego target speed, from
+   speed [mph] at the ego s. Runs after behavior_planning or
+   sampling_planning, which roll the prediction out.
+*/
+void Road::speed_planning(double speed) {
+
+  this->speed_planner.max_speed = this->speed_limit / 2.24;
+
+  this->speed_planner.plan(this->ego.s, speed / 2.24, 0, this->ego.lane, this->ego.v / 2.24,
+                           this->prediction);
 }
 
 void Road::add_ego(int lane_num, int s, double vel, vector<int> config_data) {
@@ -82,51 +164,101 @@ void Road::add_ego(int lane_num, int s, double vel, vector<int> config_data) {
   Vehicle ego = Vehicle(lane_num, s, vel, 0);
 
   ego.configure(config_data);
-  ego.state = "KL";
+  ego.state = State::KL;
 
-  this->vehicles.insert(std::pair<int,Vehicle>(ego_key,ego));
+  this->ego = ego;
 
 }
 
-void Road::add_vehicles_surrounding(vector<vector<double>> sensor_fusion, int prev_size) {
-
-  Vehicle ego;
-
-  map<int, Vehicle>::iterator it = this->vehicles.begin();
-
-  while(it != this->vehicles.end()) {
+/*
+   Takes over a new planner configuration between cycles: limits, lane
+   speeds, goal and buffer of the ego and the cost weights. The lane
+   count stays, ConfigStore rejects changing it. The lattice keeps the
+   speed limit it was built with.
+*/
+void Road::configure(const PlannerConfig & config) {
 
-    // delete all fused vehicles except ego
-    if (it->first != ego_key) it = this->vehicles.erase(it);
-    else {
+  this->lane_speeds  = config.lane_speeds;
+  this->speed_limit  = config.speed_limit;
+  this->cost_weights = config.weights;
 
-      ego = it->second;
-    }
+  this->ego.configure(config.ego_config());
+  this->ego.preferred_buffer = config.preferred_buffer;
+}
 
-    it++;
-  }
-  this->vehicles.clear();
+/*
+   Updates the track table from sensor fusion data in place,
+   elapsed is the time [s] since the previous message (0 if unknown).
+   Measurements go through the Kalman tracker, tracks missing from the
+   message coast on their filter until they expire. Entries with a
+   negative d or an id outside [0, max_tracks) are skipped.
+*/
+void Road::add_vehicles_surrounding(const vector<vector<double>> & sensor_fusion, int prev_size,
+                                    double elapsed) {
 
-  this->vehicles.insert(std::pair<int,Vehicle>(ego_key,ego));
+  this->frame++;
 
   for (auto &fused_info: sensor_fusion){
 
     if (fused_info[6] < 0) continue;
-    auto l = (int) fused_info[6] / 4; //lane is 4 meter
+
+    if (!(fused_info[0] >= 0 && fused_info[0] < this->max_tracks)) continue;
 
     double vx = fused_info[3];
     double vy = fused_info[4];
     auto v    = sqrt( vx*vx + vy*vy);
 
-    auto s = fused_info[5];
-    // if using previous points can project x_value
-    s += (double)prev_size * .02 * v;
+    double s  = fused_info[5];
+    double d  = fused_info[6];
+    int    id = fused_info[0]; // ID number
+
+    if (id >= (int) this->tracks.size()) this->tracks.resize(id + 1);
+
+    Track &track = this->tracks[id];
+
+    if (!track.active) {
+
+      track.active = true;
+      track.generation++;
+    }
+
+    track.last_seen = this->frame;
+
+    this->tracker.measure(id, track.generation, s, v, d);
+  }
+
+  this->tracker.update(elapsed);
+
+  // if using previous points can project s
+  double t = (double)prev_size * .02;
+
+  this->prediction.clear();
+
+  for (int id = 0; id < (int) this->tracks.size(); id++) {
+
+    Track &track = this->tracks[id];
+
+    if (!track.active) continue;
+
+    if (this->frame - track.last_seen > this->max_missed_frames) {
+
+      track.active = false;
+      this->tracker.drop(id);
+      this->predictions.erase(id);
+      continue;
+    }
+
+    track.v     = this->tracker.s_dot(id);
+    track.a     = this->tracker.s_ddot(id);
+    track.s     = this->tracker.s(id) + track.v * t + track.a * t * t / 2;
+    track.d     = this->tracker.d(id);
+    track.d_dot = this->tracker.d_dot(id);
+
+    auto l = (int) track.d / 4; //lane is 4 meter
 
-    Vehicle vehicle = Vehicle(l,s,v,0);
-    vehicle.state   = "CS";
+    track.vehicle = Vehicle(l, track.s, track.v, track.a, State::CS);
 
-    this->vehicles_added = fused_info[0]; // ID number
-    this->vehicles.insert(std::pair<int,Vehicle>(vehicles_added,vehicle));
+    this->prediction.add(id, track.s, track.d, track.v, track.a, track.d_dot);
   }
 
 }
@@ -0,0 +1,546 @@
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <type_traits>
+#include "Behavior_planning/session.h"
+#include "Behavior_planning/perf_counters.h"
+#include "Behavior_planning/stage.h"
+#include "helper_functions.h"
+
+static_assert(is_trivially_copyable<Track>::value, "Track is checkpointed as raw bytes");
+static_assert(is_trivially_copyable<LaneChange>::value, "LaneChange is checkpointed as raw bytes");
+
+static const uint32_t CHECKPOINT_MAGIC  = 0x4b435050;  // "PPCK"
+static const uint32_t CHECKPOINT_FORMAT = 1;
+
+template <typename T>
+static void put(string & blob, const T & value) {
+
+  blob.append((const char *) &value, sizeof(T));
+}
+
+template <typename T>
+static bool get(const char * & p, const char * end, T & value) {
+
+  if (end - p < (long) sizeof(T)) return false;
+
+  memcpy(&value, p, sizeof(T));
+  p += sizeof(T);
+  return true;
+}
+
+// pointers into the Road the vehicle was planned on, set again every cycle
+static void detach(Vehicle & vehicle) {
+
+  vehicle.collision_checker = nullptr;
+  vehicle.occupancy_grid    = nullptr;
+  vehicle.lane_features     = nullptr;
+  vehicle.cost_weights      = nullptr;
+}
+
+/*
+   Header: magic, format and the struct sizes, so a checkpoint of
+   another build is rejected rather than misread.
+*/
+void Session::checkpoint(string & blob) const {
+
+  blob.clear();
+
+  put(blob, CHECKPOINT_MAGIC);
+  put(blob, CHECKPOINT_FORMAT);
+  put(blob, (uint32_t) sizeof(Vehicle));
+  put(blob, (uint32_t) sizeof(Track));
+
+  put(blob, lane);
+  put(blob, ref_vel);
+  put(blob, sent_size);
+  put(blob, sim_time);
+  put(blob, lane_change);
+
+  put(blob, road.ego);
+  put(blob, road.frame);
+
+  put(blob, (uint32_t) road.tracks.size());
+
+  for (const Track & track : road.tracks) put(blob, track);
+
+  put(blob, (uint32_t) road.tracker.filters.size());
+
+  for (const Tracker::Filter & filter : road.tracker.filters) {
+
+    blob.append((const char *) filter.x.data(), sizeof(double) * filter.x.size());
+    blob.append((const char *) filter.P.data(), sizeof(double) * filter.P.size());
+    blob.append((const char *) filter.z.data(), sizeof(double) * filter.z.size());
+
+    put(blob, filter.active);
+    put(blob, filter.measured);
+    put(blob, filter.fresh);
+    put(blob, filter.generation);
+  }
+}
+
+bool Session::restore(const string & blob, const ManeuverTemplates * templates) {
+
+  const char * p   = blob.data();
+  const char * end = p + blob.size();
+
+  uint32_t magic, format, vehicle_size, track_size, tracks, filters;
+
+  if (!get(p, end, magic) || magic != CHECKPOINT_MAGIC) return false;
+  if (!get(p, end, format) || format != CHECKPOINT_FORMAT) return false;
+  if (!get(p, end, vehicle_size) || vehicle_size != sizeof(Vehicle)) return false;
+  if (!get(p, end, track_size) || track_size != sizeof(Track)) return false;
+
+  // decoded into copies first, the session changes only on success
+  int        lane_, sent_size_, frame_;
+  double     ref_vel_, sim_time_;
+  LaneChange lane_change_;
+  Vehicle    ego_;
+
+  if (!get(p, end, lane_) || !get(p, end, ref_vel_) || !get(p, end, sent_size_)
+      || !get(p, end, sim_time_) || !get(p, end, lane_change_)
+      || !get(p, end, ego_) || !get(p, end, frame_) || !get(p, end, tracks)) return false;
+
+  // the payload may come from disk: everything that later indexes a
+  // table or feeds the planner is checked against this session
+  int lanes = road.ego.lanes_available;
+
+  if (lane_ < 0 || lane_ >= lanes || sent_size_ < 0) return false;
+  if (!isfinite(ref_vel_) || !isfinite(sim_time_)) return false;
+
+  if (static_cast<int>(ego_.state) > static_cast<int>(State::LCR)) return false;
+  if (ego_.lane < 0 || ego_.lane >= lanes || !isfinite(ego_.v) || !isfinite(ego_.a)) return false;
+
+  if (!isfinite(lane_change_.from_d) || !isfinite(lane_change_.to_d)) return false;
+
+  if (lane_change_.active()
+      && !(templates && lane_change_.id < (int) templates->steps.size()
+           && lane_change_.step >= 0 && lane_change_.step <= templates->steps[lane_change_.id])) return false;
+
+  if ((int) tracks > road.max_tracks) return false;
+
+  const size_t filter_size = sizeof(double) * (6 + 36 + 3) + 3 * sizeof(bool) + sizeof(int);
+
+  if ((size_t) (end - p) < tracks * sizeof(Track)) return false;
+
+  vector<Track> tracks_(tracks);
+
+  for (Track & track : tracks_) {
+
+    get(p, end, track);
+    detach(track.vehicle);
+  }
+
+  if (!get(p, end, filters) || (int) filters > road.max_tracks
+      || (size_t) (end - p) != filters * filter_size) return false;
+
+  decltype(road.tracker.filters) filters_(filters);
+
+  for (Tracker::Filter & filter : filters_) {
+
+    memcpy(filter.x.data(), p, sizeof(double) * 6);  p += sizeof(double) * 6;
+    memcpy(filter.P.data(), p, sizeof(double) * 36); p += sizeof(double) * 36;
+    memcpy(filter.z.data(), p, sizeof(double) * 3);  p += sizeof(double) * 3;
+
+    get(p, end, filter.active);
+    get(p, end, filter.measured);
+    get(p, end, filter.fresh);
+    get(p, end, filter.generation);
+  }
+
+  // Tracker reads the filter of every active track by its id
+  for (uint32_t id = 0; id < tracks; id++) {
+
+    if (!tracks_[id].active) continue;
+
+    if (id >= filters || !filters_[id].x.allFinite() || !filters_[id].P.allFinite()) return false;
+  }
+
+  detach(ego_);
+
+  // the ego limits come from the configuration in use, not the checkpoint
+  ego_.target_speed     = road.ego.target_speed;
+  ego_.max_speed        = road.ego.max_speed;
+  ego_.max_acceleration = road.ego.max_acceleration;
+  ego_.preferred_buffer = road.ego.preferred_buffer;
+  ego_.lanes_available  = road.ego.lanes_available;
+  ego_.goal_s           = road.ego.goal_s;
+  ego_.goal_lane        = road.ego.goal_lane;
+
+  lane        = lane_;
+  ref_vel     = ref_vel_;
+  sent_size   = sent_size_;
+  sim_time    = sim_time_;
+  lane_change = lane_change_;
+
+  road.ego    = ego_;
+  road.frame  = frame_;
+  road.tracks.swap(tracks_);
+  road.tracker.filters.swap(filters_);
+  road.predictions.clear();
+
+  return true;
+}
+
+Control Session::plan(const Telemetry & telemetry, const PlanningContext & context) {
+
+  // counters of a worker start with the first cycle it runs
+  if (context.perf_counters) PerfCounters::enable();
+
+  // heap use of the cycle, counted with -DALLOC_ACCOUNTING=ON
+  LedgerScope ledger_scope(ledger);
+
+  {
+    // a configuration published since the last cycle
+    ConfigStore::ReadGuard config(context.config_store);
+
+    if (config->version != config_version) {
+
+      road.configure(*config);
+      config_version = config->version;
+    }
+  }
+
+  // Main car's localization Data
+  double car_x   = telemetry.car_x;
+  double car_y   = telemetry.car_y;
+  double car_s   = telemetry.car_s;
+  double car_d   = telemetry.car_d;
+  double car_yaw = telemetry.car_yaw;
+
+  // Previous path data given to the Planner
+  const vector<double> & previous_path_x = telemetry.previous_path_x;
+  const vector<double> & previous_path_y = telemetry.previous_path_y;
+
+  int prev_size = previous_path_x.size();
+
+  if (prev_size > 0) car_s = telemetry.end_path_s;
+
+  road.ego_localization(car_s);
+
+  // the simulator drives 1 path point every 20 ms
+  double elapsed = (sent_size - prev_size) * .02;
+
+  {
+    StageScope stage(Stage::TRACKING);
+    road.add_vehicles_surrounding(telemetry.sensor_fusion, prev_size, elapsed);
+  }
+
+  sim_time += elapsed;
+
+  bool behavior = !context.multi_rate || scheduler.due(road, sim_time);
+
+  if (context.pool) {
+
+    road.sampler.share_pool(context.pool);
+    road.speed_planner.share_pool(context.pool);
+  }
+
+  if (context.multi_rate) {
+
+    const SchedulerStats & stats = scheduler.stats;
+
+    cout << " [SCHEDULER] " << stats.behavior_cycles_per_message()
+         << " behavior cycles/message (" << stats.behavior_cycles << "/"
+         << stats.messages << "), "
+         << stats.triggers[static_cast<int>(Trigger::DEADLINE)] << " deadline, "
+         << stats.triggers[static_cast<int>(Trigger::OCCUPANCY)] << " occupancy"
+         << (behavior ? "" : ", last decision kept") << endl;
+  }
+
+  if (!behavior) {
+
+    // the last decision stands, ego keeps its lane and target speed
+
+  } else if (context.planner == Planner::SAMPLING) {
+
+    // start from the end of the previous path, like car_s
+    road.sampling_planning(ref_vel, prev_size > 0 ? telemetry.end_path_d : car_d);
+
+    const SamplerStats & stats = road.sampler.stats;
+
+    cout << " [SAMPLER] " << stats.candidates << " candidates in "
+         << stats.elapsed_ms << " ms (" << stats.candidates_per_ms()
+         << " candidates/ms, " << stats.threads << " threads), "
+         << stats.collisions << " colliding" << endl;
+
+  } else if (context.planner == Planner::LATTICE) {
+
+    road.lattice_planning(ref_vel);
+
+    const LatticeStats & stats = road.lattice.stats;
+
+    cout << " [LATTICE] " << road.lattice.path.size() << " primitives, "
+         << stats.expansions << " expansions, " << stats.cell_checks
+         << " footprint checks in " << stats.elapsed_ms << " ms"
+         << (stats.found ? "" : ", no path: FSM fallback") << endl;
+
+  } else {
+
+    road.behavior_planning();
+  }
+
+  Vehicle ego = road.get_ego();
+
+  cout << " [EGO] state: " << ego.state
+       << " lane:"  << ego.lane
+       << " velocity: " << ego.v
+       << " ego_s: " << ego.s << " car_s: " << car_s
+       << endl;
+
+  int from_lane = lane;
+
+  if (car_d < (2 + 4*lane +2) && car_d > (2 + 4*lane -2)) lane = ego.lane;
+
+  const ManeuverTemplates * templates = context.templates;
+
+  if (templates && lane != from_lane) {
+
+    // from the end of the previous path, mid maneuver if need be
+    double from_d = lane_change.active() ? lane_change.d(*templates, lane_change.step - 1)
+                                         : 2 + 4*from_lane;
+
+    lane_change.id     = templates->select(ref_vel / 2.24);
+    lane_change.step   = 0;
+    lane_change.from_d = from_d;
+    lane_change.to_d   = 2 + 4*lane;
+
+    cout << " [TEMPLATE] lane change " << from_lane << " -> " << lane << " over "
+         << templates->duration(lane_change.id) << " s at "
+         << templates->speed(lane_change.id) << " m/s" << endl;
+  }
+
+  if (context.speed_planner) {
+
+    // the behavior cycle rolls the prediction out, otherwise it is stale
+    if (!behavior) road.prediction.rollout();
+
+    road.speed_planning(ref_vel);
+
+    const SpeedPlannerStats & stats = road.speed_planner.stats;
+
+    cout << " [SPEED] " << stats.columns << "x" << stats.rows << " s-t grid in "
+         << stats.elapsed_ms << " ms, " << stats.threads << " threads"
+         << (stats.feasible ? "" : ", no free path: braking") << endl;
+
+  } else {
+
+    if (ref_vel > ego.v)
+       ref_vel -= .224 * 2 ;
+
+    else if (ref_vel < ego.v)
+       ref_vel += .224 * 2;
+  }
+
+  // Create a list of widely spaced (x,y) waypoints, evenly spaced at 30m
+  // Later we will interoplate these waypoints with a spline and
+  // fill it in with more points that control speed
+
+  StageScope spline_stage(Stage::SPLINE);
+
+  Waypoints wp(prev_size, lane, car_x, car_y, car_yaw, car_s,
+               context.maps_s, context.maps_x, context.maps_y,
+               previous_path_x, previous_path_y);
+
+  if (context.smooth_path) wp.smoother = &smoother;
+
+  if (templates) {
+
+    wp.templates   = templates;
+    wp.lane_change = &lane_change;
+  }
+
+  if (context.planner == Planner::SAMPLING && road.sampler.best >= 0) {
+
+    // lateral profile of the selected candidate at the anchor points
+    vector<double> anchor_s = {car_s + 30, car_s + 60, car_s + 90};
+    vector<double> anchor_d;
+
+    for (double s : anchor_s)
+      anchor_d.push_back(road.sampler.d_at_s(road.sampler.best, s));
+
+    wp.spaced_waypoints_generator(anchor_s, anchor_d);
+
+  } else {
+
+    wp.spaced_waypoints_generator ();
+  }
+
+  if (context.smooth_path) {
+
+    const SmootherStats & stats = smoother.stats;
+
+    cout << " [SMOOTH] " << stats.nodes << " nodes, " << stats.active
+         << " at the corridor, " << stats.iterations << " factorization(s)"
+         << (stats.analyzed ? " + symbolic" : "") << " in "
+         << stats.elapsed_ms << " ms" << endl;
+  }
+
+  if (context.speed_planner) {
+
+    // speed profile at the new points, 20 ms apart from the end of the previous path
+    vector<double> speeds;
+
+    for (int i = 1; i <= 50 - prev_size; i++)
+      speeds.push_back(road.speed_planner.speed_at(i * .02) * 2.24);
+
+    if (speeds.size() > 0) ref_vel = speeds.back();
+
+    wp.detailed_waypoints_generator(speeds);
+
+  } else {
+
+    wp.detailed_waypoints_generator(ref_vel);
+  }
+
+  sent_size = wp.next_x_vals.size();
+
+  if (feasibility.check(wp.next_x_vals, wp.next_y_vals) >= 0) {
+
+    const FeasibilityStats & stats = feasibility.stats;
+
+    cout << " [FEASIBILITY] " << stats.violation << " limit exceeded at point "
+         << stats.first << " of " << stats.points << ", peaks: "
+         << stats.speed << " m/s, " << stats.lon_accel << "/" << stats.lat_accel
+         << " m/s^2 lon/lat, " << stats.jerk << " m/s^3, "
+         << stats.curvature << " 1/m" << endl;
+  }
+
+  if (context.checkpoints) {
+
+    StageScope stage(Stage::OTHER);
+    checkpoint(checkpoint_buffer);
+    context.checkpoints->put(token, checkpoint_buffer);
+  }
+
+  Control control;
+  control.next_x.swap(wp.next_x_vals);
+  control.next_y.swap(wp.next_y_vals);
+
+  return control;
+}
+
+string CheckpointStore::new_token() {
+
+  static const char hex[] = "0123456789abcdef";
+
+  random_device random;
+
+  string token;
+
+  for (int i = 0; i < 4; i++) {
+
+    uint32_t bits = random();
+
+    for (int k = 0; k < 8; k++, bits >>= 4) token += hex[bits & 15];
+  }
+
+  return token;
+}
+
+// tokens name files, only new_token() ones are accepted
+static bool valid_token(const string & token) {
+
+  if (token.empty() || token.size() > 64) return false;
+
+  for (char c : token)
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) return false;
+
+  return true;
+}
+
+string CheckpointStore::path(const string & token) const {
+
+  return directory + "/" + token + ".ckpt";
+}
+
+/*
+   Workers call this every cycle, so it only swaps buffers: blob gets
+   the previous checkpoint of token back, its capacity reused by the
+   next one. Expiry is left to get() and persist().
+*/
+void CheckpointStore::put(const string & token, string & blob) {
+
+  clock::time_point now = clock::now();
+
+  lock_guard<mutex> lock(mutex_);
+
+  pair<clock::time_point, string> & entry = checkpoints_[token];
+
+  entry.first = now;
+  entry.second.swap(blob);
+}
+
+// mutex_ held
+void CheckpointStore::expire() {
+
+  clock::time_point now = clock::now();
+
+  for (auto it = checkpoints_.begin(); it != checkpoints_.end(); ) {
+
+    if (chrono::duration<double>(now - it->second.first).count() > ttl) it = checkpoints_.erase(it);
+    else ++it;
+  }
+}
+
+bool CheckpointStore::get(const string & token, string & blob) {
+
+  if (!valid_token(token)) return false;
+
+  {
+    lock_guard<mutex> lock(mutex_);
+
+    expire();
+
+    auto it = checkpoints_.find(token);
+
+    if (it != checkpoints_.end()) {
+
+      blob = it->second.second;
+      return true;
+    }
+  }
+
+  if (directory.empty()) return false;
+
+  ifstream in(path(token).c_str(), ios::binary);
+
+  if (!in) return false;
+
+  blob.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+  return !blob.empty();
+}
+
+bool CheckpointStore::persist(const string & token) {
+
+  if (directory.empty() || !valid_token(token)) return false;
+
+  string blob;
+
+  {
+    lock_guard<mutex> lock(mutex_);
+
+    expire();
+
+    auto it = checkpoints_.find(token);
+
+    if (it == checkpoints_.end()) return false;
+
+    blob = it->second.second;
+  }
+
+  ofstream out(path(token).c_str(), ios::binary | ios::trunc);
+
+  out.write(blob.data(), blob.size());
+
+  return (bool) out;
+}
+
+int CheckpointStore::size() {
+
+  lock_guard<mutex> lock(mutex_);
+  return (int) checkpoints_.size();
+}
@@ -0,0 +1,256 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+#include "Behavior_planning/shm_transport.h"
+
+static const uint32_t SHM_MAGIC = 0x4d485350;  // "PSHM"
+
+// min and max take them by reference
+const int TelemetryRecord::max_path;
+const int TelemetryRecord::max_vehicles;
+const int ControlRecord::max_path;
+
+void to_record(const Telemetry & telemetry, uint64_t seq, TelemetryRecord & record) {
+
+  record.seq        = seq;
+  record.car_x      = telemetry.car_x;
+  record.car_y      = telemetry.car_y;
+  record.car_s      = telemetry.car_s;
+  record.car_d      = telemetry.car_d;
+  record.car_yaw    = telemetry.car_yaw;
+  record.car_speed  = telemetry.car_speed;
+  record.end_path_s = telemetry.end_path_s;
+  record.end_path_d = telemetry.end_path_d;
+
+  record.prev_size    = min((int) telemetry.previous_path_x.size(), TelemetryRecord::max_path);
+  record.num_vehicles = min((int) telemetry.sensor_fusion.size(), TelemetryRecord::max_vehicles);
+
+  copy_n(telemetry.previous_path_x.begin(), record.prev_size, record.previous_path_x);
+  copy_n(telemetry.previous_path_y.begin(), record.prev_size, record.previous_path_y);
+
+  for (int i = 0; i < record.num_vehicles; i++) {
+
+    const vector<double> & vehicle = telemetry.sensor_fusion[i];
+
+    for (int k = 0; k < 7; k++) record.sensor_fusion[i][k] = k < (int) vehicle.size() ? vehicle[k] : 0;
+  }
+}
+
+void from_record(const TelemetryRecord & record, Telemetry & telemetry) {
+
+  telemetry.car_x      = record.car_x;
+  telemetry.car_y      = record.car_y;
+  telemetry.car_s      = record.car_s;
+  telemetry.car_d      = record.car_d;
+  telemetry.car_yaw    = record.car_yaw;
+  telemetry.car_speed  = record.car_speed;
+  telemetry.end_path_s = record.end_path_s;
+  telemetry.end_path_d = record.end_path_d;
+
+  int prev_size    = max(0, min((int) record.prev_size, TelemetryRecord::max_path));
+  int num_vehicles = max(0, min((int) record.num_vehicles, TelemetryRecord::max_vehicles));
+
+  telemetry.previous_path_x.assign(record.previous_path_x, record.previous_path_x + prev_size);
+  telemetry.previous_path_y.assign(record.previous_path_y, record.previous_path_y + prev_size);
+
+  telemetry.sensor_fusion.resize(num_vehicles);
+
+  for (int i = 0; i < num_vehicles; i++)
+    telemetry.sensor_fusion[i].assign(record.sensor_fusion[i], record.sensor_fusion[i] + 7);
+}
+
+void to_record(const Control & control, uint64_t seq, ControlRecord & record) {
+
+  record.seq  = seq;
+  record.size = min((int) control.next_x.size(), ControlRecord::max_path);
+
+  copy_n(control.next_x.begin(), record.size, record.next_x);
+  copy_n(control.next_y.begin(), record.size, record.next_y);
+}
+
+void from_record(const ControlRecord & record, Control & control) {
+
+  int size = max(0, min((int) record.size, ControlRecord::max_path));
+
+  control.next_x.assign(record.next_x, record.next_x + size);
+  control.next_y.assign(record.next_y, record.next_y + size);
+}
+
+#ifdef __linux__
+
+// shared, not FUTEX_PRIVATE: the waiter and the waker are different processes
+static void wait_on(atomic<uint32_t> * word, uint32_t value, const timespec * timeout) {
+
+  syscall(SYS_futex, (uint32_t *) word, FUTEX_WAIT, value, timeout, nullptr, 0);
+}
+
+static void wake_all(atomic<uint32_t> * word) {
+
+  syscall(SYS_futex, (uint32_t *) word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#else
+
+// no futex, the consumer naps between polls
+static void wait_on(atomic<uint32_t> *, uint32_t, const timespec *) {
+
+  timespec nap = {0, 50000};
+  nanosleep(&nap, nullptr);
+}
+
+static void wake_all(atomic<uint32_t> *) {}
+
+#endif
+
+template <typename T, uint32_t N>
+bool SpscRing<T, N>::push(const T & record) {
+
+  uint32_t h = head.load(memory_order_relaxed);
+
+  if (h - tail.load(memory_order_acquire) == N) return false;
+
+  slots[h % N] = record;
+
+  head.store(h + 1);
+
+  if (sleeping.load()) wake_all(&head);
+
+  return true;
+}
+
+template <typename T, uint32_t N>
+bool SpscRing<T, N>::pop(T & record, int timeout_ms) {
+
+  uint32_t t = tail.load(memory_order_relaxed);
+
+  timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+  deadline.tv_sec  += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+
+  if (deadline.tv_nsec >= 1000000000L) { deadline.tv_sec++; deadline.tv_nsec -= 1000000000L; }
+
+  for (int spin = 0; head.load(memory_order_acquire) == t; spin++) {
+
+    if (spin < 1000) continue;
+
+    sleeping.store(1);
+
+    // a push after the store sees sleeping, one before it is seen here
+    uint32_t h = head.load();
+
+    if (h == t) {
+
+      timespec now, left;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+
+      left.tv_sec  = deadline.tv_sec - now.tv_sec;
+      left.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+
+      if (left.tv_nsec < 0) { left.tv_sec--; left.tv_nsec += 1000000000L; }
+
+      if (timeout_ms >= 0 && left.tv_sec < 0) { sleeping.store(0); return false; }
+
+      wait_on(&head, t, timeout_ms >= 0 ? &left : nullptr);
+    }
+
+    sleeping.store(0);
+  }
+
+  record = slots[t % N];
+
+  tail.store(t + 1, memory_order_release);
+
+  return true;
+}
+
+ShmTransport::~ShmTransport() {
+
+  if (region_) munmap(region_, sizeof(Region));
+
+  if (owner_) shm_unlink(name_.c_str());
+}
+
+bool ShmTransport::map(const string & name, bool create) {
+
+  int fd = shm_open(name.c_str(), create ? O_CREAT | O_RDWR | O_TRUNC : O_RDWR, 0600);
+
+  if (fd < 0) return false;
+
+  if (create && ftruncate(fd, sizeof(Region)) != 0) { close(fd); return false; }
+
+  void * memory = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (memory == MAP_FAILED) return false;
+
+  region_ = (Region *) memory;
+  name_   = name;
+  owner_  = create;
+
+  return true;
+}
+
+bool ShmTransport::create(const string & name) {
+
+  if (!map(name, true)) return false;
+
+  region_->telemetry.init();
+  region_->control.init();
+  region_->size = sizeof(Region);
+
+  atomic_thread_fence(memory_order_release);
+
+  region_->magic = SHM_MAGIC;
+
+  return true;
+}
+
+bool ShmTransport::attach(const string & name) {
+
+  if (!map(name, false)) return false;
+
+  atomic_thread_fence(memory_order_acquire);
+
+  // another build or a region not set up yet
+  if (region_->magic != SHM_MAGIC || region_->size != sizeof(Region)) {
+
+    munmap(region_, sizeof(Region));
+    region_ = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+bool ShmTransport::send(const TelemetryRecord & record) {
+
+  return region_ && region_->telemetry.push(record);
+}
+
+bool ShmTransport::send(const ControlRecord & record) {
+
+  return region_ && region_->control.push(record);
+}
+
+bool ShmTransport::receive(TelemetryRecord & record, int timeout_ms) {
+
+  return region_ && region_->telemetry.pop(record, timeout_ms);
+}
+
+bool ShmTransport::receive(ControlRecord & record, int timeout_ms) {
+
+  return region_ && region_->control.pop(record, timeout_ms);
+}
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include "Behavior_planning/speed_planner.h"
+
+/*
+   Relaxes the edges of one delta into n rows of a column, written as
+   a flat loop over rows so the compiler vectorizes it. The prev_*
+   rows are the parents, delta rows below.
+*/
+static void relax_delta(int n, float v, float inv_dt, float cost_v,
+                        float max_accel, float max_decel, float w_accel, float w_jerk,
+                        int delta,
+                        const float * __restrict__ prev_cost,
+                        const float * __restrict__ prev_speed,
+                        const float * __restrict__ prev_accel,
+                        float * __restrict__ cost,
+                        float * __restrict__ speed,
+                        float * __restrict__ accel,
+                        int * __restrict__ parent)
+{
+
+  const float inf = numeric_limits<float>::infinity();
+
+  for (int i = 0; i < n; i++) {
+
+    float a = (v - prev_speed[i]) * inv_dt;
+    float j = (a - prev_accel[i]) * inv_dt;
+
+    float c = prev_cost[i] + cost_v + w_accel * a * a + w_jerk * j * j;
+
+    // edges over the limits cost inf
+    c += a >  max_accel ? inf : 0.0f;
+    c += a < -max_decel ? inf : 0.0f;
+
+    // written as selects on the kept node, which the compiler turns
+    // into a min and blends
+    float best = cost[i];
+
+    float kept_speed  = best <= c ? speed[i]  : v;
+    float kept_accel  = best <= c ? accel[i]  : a;
+    int   kept_parent = best <= c ? parent[i] : delta;
+
+    cost[i]   = best <= c ? best : c;
+    speed[i]  = kept_speed;
+    accel[i]  = kept_accel;
+    parent[i] = kept_parent;
+  }
+}
+
+void SpeedPlanner::resize() {
+
+  int columns = (int) (horizon / dt + 0.5) + 1;
+  int rows    = (int) ceil(max_speed * horizon / ds) + 1;
+
+  if (columns != this->columns || rows != this->rows) {
+
+    this->columns = columns;
+    this->rows    = rows;
+
+    cost.resize(columns * rows);
+    speed.resize(columns * rows);
+    accel.resize(columns * rows);
+    parent.resize(columns * rows);
+    blocked.resize(columns * rows);
+
+    path_s.resize(columns);
+    path_v.resize(columns);
+  }
+}
+
+bool SpeedPlanner::plan(float s, float v, float a, int lane, float v_ref,
+                        const Prediction & prediction) {
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  const float inf = numeric_limits<float>::infinity();
+
+  resize();
+
+  this->s0_    = s;
+  this->v_ref_ = min(v_ref, max_speed);
+
+  block(s, lane, prediction);
+
+  // only the ego start is reachable in column 0
+  fill(cost.begin(), cost.begin() + rows, inf);
+  fill(speed.begin(), speed.begin() + rows, 0);
+  fill(accel.begin(), accel.begin() + rows, 0);
+
+  cost[0]  = 0;
+  speed[0] = v;
+  accel[0] = a;
+
+  bool parallel = rows >= parallel_threshold;
+
+  if (parallel && !pool_) pool_ = make_shared<ThreadPool>(num_threads);
+
+  int max_delta = (int) (max_speed * dt / ds);
+
+  stats.edges = (long) (columns - 1) * rows * (max_delta + 1);
+
+  int threads = 1;
+
+  for (int k = 1; k < columns; k++) {
+
+    if (parallel) {
+
+      threads = max(threads, pool_->parallel_for(rows, 256, [this, k](int begin, int end) { relax_rows(k, begin, end); }));
+
+    } else {
+
+      relax_rows(k, 0, rows);
+    }
+  }
+
+  // cheapest node of the last column
+  const float * last = &cost[(columns - 1) * rows];
+
+  int best = (int) (min_element(last, last + rows) - last);
+
+  stats.columns  = columns;
+  stats.rows     = rows;
+  stats.feasible = last[best] < inf;
+  stats.threads  = threads;
+
+  if (stats.feasible) {
+
+    backtrack(columns - 1, best);
+
+  } else {
+
+    for (int k = 0; k < columns; k++) {
+
+      float t_stop = v / max_decel;
+      float t      = min(k * dt, t_stop);
+
+      path_v[k] = v - max_decel * t;
+      path_s[k] = s + v * t - 0.5f * max_decel * t * t;
+    }
+  }
+
+  chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+  stats.elapsed_ms = elapsed.count();
+
+  return stats.feasible;
+}
+
+/*
+   Blocks the rows a vehicle of the lane, or straddling into it,
+   covers at every column, from min_gap behind it to its rear end
+   ahead of it. Vehicles starting behind the ego are left to the
+   collision checks of the behavior layer.
+*/
+void SpeedPlanner::block(float s, int lane, const Prediction & prediction) {
+
+  fill(blocked.begin(), blocked.end(), 0);
+
+  float center = (lane + 0.5f) * lane_width;
+  float half_s = 0.5f * max_s;
+
+  const float * s_start = prediction.s_row(0);
+
+  for (int j = 0; j < prediction.size; j++) {
+
+    float rel0 = s_start[j] - s;
+
+    rel0 = rel0 >  half_s ? rel0 - max_s : rel0;
+    rel0 = rel0 < -half_s ? rel0 + max_s : rel0;
+
+    if (rel0 < 0) continue;
+
+    // column 0 is the ego start, it is never blocked
+    for (int k = 1; k < columns; k++) {
+
+      int step = min(prediction.steps - 1, (int) (k * dt / prediction.dt + 0.5f));
+
+      float d = prediction.d_row(step)[j];
+
+      if (fabs(d - center) >= lane_width - straddle) continue;
+
+      float rel = prediction.s_row(step)[j] - s;
+
+      rel = rel >  half_s ? rel - max_s : rel;
+      rel = rel < -half_s ? rel + max_s : rel;
+
+      int i0 = max(0, (int) ceil((rel - min_gap) / ds));
+      int i1 = min(rows - 1, (int) floor((rel + vehicle_length) / ds));
+
+      unsigned char * column = &blocked[k * rows];
+
+      for (int i = i0; i <= i1; i++) column[i] = 1;
+    }
+  }
+}
+
+void SpeedPlanner::relax_rows(int k, int begin, int end) {
+
+  const float inf = numeric_limits<float>::infinity();
+
+  int prev = (k - 1) * rows;
+  int next = k * rows;
+
+  fill(&cost[next + begin], &cost[next + end], inf);
+
+  int max_delta = (int) (max_speed * dt / ds);
+
+  for (int delta = 0; delta <= max_delta; delta++) {
+
+    float v  = delta * ds / dt;
+    float dv = v_ref_ - v;
+
+    int first = max(begin, delta);
+
+    if (first >= end) break;
+
+    int parent_row = prev + first - delta;
+
+    relax_delta(end - first, v, 1 / dt, w_speed * dv * dv, max_accel, max_decel, w_accel, w_jerk, delta,
+                &cost[parent_row], &speed[parent_row], &accel[parent_row],
+                &cost[next + first], &speed[next + first], &accel[next + first], &parent[next + first]);
+  }
+
+  const unsigned char * column = &blocked[next];
+
+  for (int i = begin; i < end; i++) cost[next + i] = column[i] ? inf : cost[next + i];
+}
+
+void SpeedPlanner::backtrack(int k, int i) {
+
+  for (; k > 0; k--) {
+
+    path_s[k] = s0_ + i * ds;
+    path_v[k] = speed[k * rows + i];
+
+    i -= parent[k * rows + i];
+  }
+
+  path_s[0] = s0_;
+  path_v[0] = speed[0];
+}
+
+float SpeedPlanner::speed_at(float t) const {
+
+  if (columns == 0) return 0;
+
+  float x = t / dt;
+  int   k = (int) x;
+
+  if (k >= columns - 1) return path_v[columns - 1];
+  if (k < 0)            return path_v[0];
+
+  float f = x - k;
+
+  return (1 - f) * path_v[k] + f * path_v[k + 1];
+}
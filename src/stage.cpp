@@ -0,0 +1,15 @@
+#include "Behavior_planning/stage.h"
+
+thread_local Stage stage_tag = Stage::OTHER;
+
+thread_local int ledger_tag = 0;
+
+thread_local StageObserver * stage_observer = nullptr;
+
+const char * stage_name(Stage stage) {
+
+  static const char * const names[num_stages] = {"other", "parse", "tracking", "prediction",
+                                                 "candidates", "cost", "spline", "serialize"};
+
+  return names[static_cast<int>(stage)];
+}
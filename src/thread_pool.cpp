@@ -0,0 +1,93 @@
+#include <algorithm>
+#include "Behavior_planning/thread_pool.h"
+
+/**
+ * Initializes ThreadPool
+ */
+ThreadPool::ThreadPool(int num_threads) : next_(0) {
+
+  if (num_threads <= 0) num_threads = (int) thread::hardware_concurrency() - 1;
+
+  for (int i = 0; i < num_threads; i++) workers_.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool() {
+
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+
+  work_cv_.notify_all();
+
+  for (thread & worker : workers_) worker.join();
+}
+
+int ThreadPool::parallel_for(int n, int grain, const function<void(int, int)> & task) {
+
+  grain = max(grain, 1);
+
+  unique_lock<mutex> call(call_mutex_, defer_lock);
+
+  if (workers_.empty() || n <= grain || !call.try_lock()) {
+
+    if (n > 0) task(0, n);
+    return 1;
+  }
+
+  {
+    lock_guard<mutex> lock(mutex_);
+
+    task_  = &task;
+    n_     = n;
+    grain_ = grain;
+    busy_  = (int) workers_.size();
+    next_.store(0);
+    job_++;
+  }
+
+  work_cv_.notify_all();
+
+  run_chunks();
+
+  unique_lock<mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() { return busy_ == 0; });
+
+  task_ = nullptr;
+
+  return size();
+}
+
+void ThreadPool::worker() {
+
+  long seen = 0;
+
+  while (true) {
+
+    {
+      unique_lock<mutex> lock(mutex_);
+      work_cv_.wait(lock, [this, seen]() { return stop_ || job_ != seen; });
+
+      if (stop_) return;
+
+      seen = job_;
+    }
+
+    run_chunks();
+
+    lock_guard<mutex> lock(mutex_);
+    if (--busy_ == 0) done_cv_.notify_one();
+  }
+}
+
+void ThreadPool::run_chunks() {
+
+  while (true) {
+
+    int begin = next_.fetch_add(grain_);
+
+    if (begin >= n_) return;
+
+    (*task_)(begin, min(begin + grain_, n_));
+  }
+}
@@ -0,0 +1,112 @@
+#include <cmath>
+#include "Eigen-3.3/Eigen/LU"
+#include "Behavior_planning/tracker.h"
+
+/*
+   Stages a measurement of a track slot for the next update().
+   A new track generation restarts the filter.
+*/
+void Tracker::measure(int slot, int generation, double s, double v, double d) {
+
+  if (slot >= (int) this->filters.size()) this->filters.resize(slot + 1);
+
+  Filter & filter = this->filters[slot];
+
+  MeasurementVector z(s, v, d);
+
+  if (!filter.active || filter.generation != generation) {
+
+    start(filter, generation, z);
+    return;
+  }
+
+  filter.z        = z;
+  filter.measured = true;
+}
+
+void Tracker::drop(int slot) {
+
+  if (slot < (int) this->filters.size()) this->filters[slot].active = false;
+}
+
+void Tracker::start(Filter & filter, int generation, const MeasurementVector & z) {
+
+  filter.x << z(0), z(1), 0, z(2), 0, 0;
+
+  filter.P.setZero();
+  filter.P.diagonal() << sigma_s * sigma_s, sigma_v * sigma_v, 4.0,
+                         sigma_d * sigma_d, 1.0, 1.0;
+
+  filter.active     = true;
+  filter.measured   = false;
+  filter.fresh      = true;
+  filter.generation = generation;
+}
+
+/*
+   Predicts every active filter dt [s] ahead and corrects the ones
+   measured since the last update.
+*/
+void Tracker::update(double dt) {
+
+  // transition and process noise (white jerk), shared by all filters
+  StateMatrix F = StateMatrix::Identity();
+  StateMatrix Q = StateMatrix::Zero();
+
+  Eigen::Matrix<double, 3, 1> G(dt * dt * dt / 6, dt * dt / 2, dt);
+
+  for (int axis = 0; axis < 2; axis++) {
+
+    int    k = 3 * axis;
+    double q = (axis == 0) ? jerk_s * jerk_s : jerk_d * jerk_d;
+
+    F(k, k + 1)     = dt;
+    F(k, k + 2)     = dt * dt / 2;
+    F(k + 1, k + 2) = dt;
+
+    Q.block<3, 3>(k, k) = q * G * G.transpose();
+  }
+
+  MeasurementMatrix H = MeasurementMatrix::Zero();
+  H(0, 0) = 1;
+  H(1, 1) = 1;
+  H(2, 3) = 1;
+
+  MeasurementCovariance R = MeasurementCovariance::Zero();
+  R.diagonal() << sigma_s * sigma_s, sigma_v * sigma_v, sigma_d * sigma_d;
+
+  for (Filter & filter : this->filters) {
+
+    if (!filter.active) continue;
+
+    if (filter.fresh) {
+
+      filter.fresh = false;
+      continue;
+    }
+
+    filter.x = F * filter.x;
+    filter.P = F * filter.P * F.transpose() + Q;
+
+    if (filter.measured) {
+
+      MeasurementVector y = filter.z - H * filter.x;
+
+      // innovation of s across the track seam
+      if (y(0) >  0.5 * max_s) y(0) -= max_s;
+      if (y(0) < -0.5 * max_s) y(0) += max_s;
+
+      MeasurementCovariance S = H * filter.P * H.transpose() + R;
+
+      Eigen::Matrix<double, 6, 3> K = filter.P * H.transpose() * S.inverse();
+
+      filter.x += K * y;
+      filter.P  = (StateMatrix::Identity() - K * H) * filter.P;
+
+      filter.measured = false;
+    }
+
+    filter.x(0) = fmod(filter.x(0), max_s);
+    if (filter.x(0) < 0) filter.x(0) += max_s;
+  }
+}
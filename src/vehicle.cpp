@@ -4,7 +4,11 @@
 #include <map>
 #include <string>
 #include <iterator>
+#include <limits>
+#include "Behavior_planning/collision.h"
 #include "Behavior_planning/cost.h"
+#include "Behavior_planning/lane_features.h"
+#include "Behavior_planning/stage.h"
 #include "Behavior_planning/vehicle.h"
 
 /**
@@ -13,7 +17,7 @@
 
 Vehicle::Vehicle(){}
 
-Vehicle::Vehicle(int lane, float s, float v, float a, string state) {
+Vehicle::Vehicle(int lane, float s, float v, float a, State state) {
 
     this->lane  = lane;
     this->s     = s;
@@ -25,8 +29,6 @@ Vehicle::Vehicle(int lane, float s, float v, float a, string state) {
 
 }
 
-Vehicle::~Vehicle() {}
-
 /*
 Here you can implement the transition_function code from
 the Behavior Planning Pseudocode classroom concept.
@@ -41,91 +43,85 @@ OUTPUT: The the best (lowest cost) trajectory corresponding to the next
         ego vehicle state.
 
 */
-vector<Vehicle> Vehicle::choose_next_state(map<int, vector<Vehicle>> predictions)
+Trajectory Vehicle::choose_next_state(const map<int, vector<Vehicle>> & predictions,
+                                      CostStats * stats)
 {
 
-    vector<string> states = successor_states();
+    StageScope stage(Stage::CANDIDATES);
+
+    StateSet states = successor_states();
 
     float cost;
-    vector<float> costs;
-    vector<string> final_states;
-    vector<vector<Vehicle>> final_trajectories;
+    float best_cost = numeric_limits<float>::infinity();
+    Trajectory best_trajectory;
+    CostStats cost_stats;
 
     cout << "Choose next state:" << endl;
 
-    for (vector<string>::iterator it = states.begin(); it != states.end(); ++it)
+    for (const State * it = states.begin(); it != states.end(); ++it)
     {
 
-        vector<Vehicle> trajectory = generate_trajectory(*it, predictions);
+        Trajectory trajectory = generate_trajectory(*it, predictions);
 
         if (trajectory.size() != 0)
         {
 
-          cost = calculate_cost(*this, predictions, trajectory);
-          cout << "+State [" << *it << "]:" << cost << endl;
+          int pruned = cost_stats.pruned;
 
-          costs.push_back(cost);
+          {
+            StageScope stage(Stage::COST);
+            cost = calculate_cost_bounded(*this, predictions, trajectory, best_cost, cost_stats);
+          }
 
-          final_trajectories.push_back(trajectory);
+          if (cost_stats.pruned != pruned)
+            cout << "+State [" << *it << "]: >=" << cost << " (pruned)" << endl;
+          else
+            cout << "+State [" << *it << "]:" << cost << endl;
+
+          if (best_trajectory.size() == 0 || cost < best_cost)
+          {
+            best_cost       = cost;
+            best_trajectory = trajectory;
+          }
         }
     }
 
-    vector<float>::iterator best_cost = min_element(begin(costs), end(costs));
-    int best_idx                      = distance(begin(costs), best_cost);
+    cout << "Pruned: " << cost_stats.pruned << "/" << cost_stats.candidates << " candidates,"
+         << " terms: " << cost_stats.terms_evaluated << "/" << cost_stats.terms_total << endl;
+
+    if (lane_features)
+      cout << "Lane features: " << lane_features->lookups << " lookups served by "
+           << lane_features->scans << " scan(s) of " << lane_features->vehicles_per_scan << " vehicles" << endl;
 
-    return final_trajectories[best_idx];
+    if (stats) *stats = cost_stats;
+
+    return best_trajectory;
 }
 
 /* Provides the possible next states given the current
    state for the FSM discussed in the course, with the exception
    that lane changes happen instantaneously, so LCL and LCR can
    only transition back to KL.
+
+   Successors come from STATE_TABLE, states heading to a lane
+   outside of the road are dropped.
 */
-vector<string> Vehicle::successor_states()
+StateSet Vehicle::successor_states()
 {
 
-    vector<string> states;
-    states.push_back("KL");
+    StateSet states;
 
-    string state = this->state;
+    cout << "Current state: " << this->state << " lane: " << lane << endl;
 
-    cout << "Current state: " << state << " lane: " << lane << endl;
+    const StateInfo & info = state_info(this->state);
 
-    if(state.compare("KL") == 0)
+    for (int i = 0; i < info.num_successors; i++)
     {
 
-        if (lane == (lanes_available - 1)) states.push_back("PLCL");
-
-        else if (lane == 0) states.push_back("PLCR");
-
-        else
-        {
-          states.push_back("PLCL");
-          states.push_back("PLCR");
-        }
-
-    }
-    else if (state.compare("PLCL") == 0)
-    {
-
-        if (lane != 0)
-        {
-
-            states.push_back("PLCL");
-            states.push_back("LCL");
-        }
-
-    }
-    else if (state.compare("PLCR") == 0)
-    {
-
-        if (lane != (lanes_available - 1))
-        {
-
-            states.push_back("PLCR");
-            states.push_back("LCR");
-        }
+        State next_state = info.successors[i];
+        int   next_lane  = lane + lane_direction(next_state);
 
+        if (next_lane >= 0 && next_lane < lanes_available) states.push_back(next_state);
     }
 
     //If state is "LCL" or "LCR", then just return "KL"
@@ -136,27 +132,34 @@ vector<string> Vehicle::successor_states()
    Given a possible next state, generate the appropriate
    trajectory to realize the next state.
 */
-vector<Vehicle> Vehicle::generate_trajectory(string state, map<int, vector<Vehicle>> predictions)
+Trajectory Vehicle::generate_trajectory(State state, const map<int, vector<Vehicle>> & predictions)
 {
 
-    vector<Vehicle> trajectory;
+    Trajectory trajectory;
 
-    if (state.compare("CS") == 0) {
+    switch (state) {
+
+    case State::CS:
 
         trajectory = constant_speed_trajectory();
+        break;
 
-    } else if (state.compare("KL") == 0) {
+    case State::KL:
 
         trajectory = keep_lane_trajectory(predictions);
+        break;
 
-    } else if (state.compare("LCL") == 0 || state.compare("LCR") == 0) {
+    case State::LCL:
+    case State::LCR:
 
         trajectory = lane_change_trajectory(state, predictions);
+        break;
 
-    } else if (state.compare("PLCL") == 0 || state.compare("PLCR") == 0) {
+    case State::PLCL:
+    case State::PLCR:
 
         trajectory = prep_lane_change_trajectory(state, predictions);
-
+        break;
     }
     return trajectory;
 }
@@ -166,7 +169,7 @@ vector<Vehicle> Vehicle::generate_trajectory(string state, map<int, vector<Vehic
    for a given lane. Tries to choose the maximum velocity and acceleration,
    given other vehicle positions and accel/velocity constraints.
 */
-vector<float> Vehicle::get_kinematics(map<int, vector<Vehicle>> predictions, int lane)
+array<float, 3> Vehicle::get_kinematics(const map<int, vector<Vehicle>> & predictions, int lane)
 {
 
     float max_velocity_accel_limit = this->max_acceleration + this->v;
@@ -249,14 +252,14 @@ vector<float> Vehicle::get_kinematics(map<int, vector<Vehicle>> predictions, int
 /*
    Generate a constant speed trajectory.
 */
-vector<Vehicle> Vehicle::constant_speed_trajectory()
+Trajectory Vehicle::constant_speed_trajectory()
 {
 
     float next_pos = position_at(1);
 
-    vector<Vehicle> trajectory
-    = {Vehicle(this->lane, this->s, this->v, this->a, this->state),
-       Vehicle(this->lane, next_pos, this->v, 0, this->state)};
+    Trajectory trajectory;
+    trajectory.push_back(Vehicle(this->lane, this->s, this->v, this->a, this->state));
+    trajectory.push_back(Vehicle(this->lane, next_pos, this->v, 0, this->state));
     /*
     std::cout << " [Constant Speed]"
               << " lane: " << this->lane
@@ -269,18 +272,19 @@ vector<Vehicle> Vehicle::constant_speed_trajectory()
 /*
    Generate a keep lane trajectory.
 */
-vector<Vehicle> Vehicle::keep_lane_trajectory(map<int, vector<Vehicle>> predictions)
+Trajectory Vehicle::keep_lane_trajectory(const map<int, vector<Vehicle>> & predictions)
 {
 
-    vector<Vehicle> trajectory = {Vehicle(lane, this->s, this->v, this->a, state)};
+    Trajectory trajectory;
+    trajectory.push_back(Vehicle(lane, this->s, this->v, this->a, state));
 
-    vector<float> kinematics   = get_kinematics(predictions, this->lane);
+    array<float, 3> kinematics = get_kinematics(predictions, this->lane);
 
     float new_s = kinematics[0];
     float new_v = kinematics[1];
     float new_a = kinematics[2];
 
-    trajectory.push_back(Vehicle(this->lane, new_s, new_v, new_a, "KL"));
+    trajectory.push_back(Vehicle(this->lane, new_s, new_v, new_a, State::KL));
     /*
     std::cout << " [Keep Lane]"
               << " lane: " << this->lane
@@ -293,7 +297,7 @@ vector<Vehicle> Vehicle::keep_lane_trajectory(map<int, vector<Vehicle>> predicti
 /*
    Generate a trajectory preparing for a lane change.
 */
-vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions)
+Trajectory Vehicle::prep_lane_change_trajectory(State state, const map<int, vector<Vehicle>> & predictions)
 {
     float new_s;
     float new_v;
@@ -301,12 +305,12 @@ vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vect
 
     Vehicle vehicle_behind;
 
-    int new_lane = this->lane + lane_direction[state];
+    int new_lane = this->lane + lane_direction(state);
 
-    vector<Vehicle> trajectory
-    = {Vehicle(this->lane, this->s, this->v, this->a, this->state)};
+    Trajectory trajectory;
+    trajectory.push_back(Vehicle(this->lane, this->s, this->v, this->a, this->state));
 
-    vector<float> curr_lane_new_kinematics
+    array<float, 3> curr_lane_new_kinematics
     = get_kinematics(predictions, this->lane);
 
     if (get_vehicle_behind(predictions, this->lane, vehicle_behind)) {
@@ -318,9 +322,9 @@ vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vect
 
     } else {
 
-        vector<float> best_kinematics;
+        array<float, 3> best_kinematics;
 
-        vector<float> next_lane_new_kinematics
+        array<float, 3> next_lane_new_kinematics
         = get_kinematics(predictions, new_lane);
 
         //Choose kinematics with lowest velocity.
@@ -353,30 +357,45 @@ vector<Vehicle> Vehicle::prep_lane_change_trajectory(string state, map<int, vect
 /*
    Generate a lane change trajectory.
 */
-vector<Vehicle> Vehicle::lane_change_trajectory(string state, map<int, vector<Vehicle>> predictions)
+Trajectory Vehicle::lane_change_trajectory(State state, const map<int, vector<Vehicle>> & predictions)
 {
 
-    int new_lane = this->lane + lane_direction[state];
-    vector<Vehicle> trajectory;
-    Vehicle next_lane_vehicle;
+    int new_lane = this->lane + lane_direction(state);
+    Trajectory trajectory;
 
     //Check if a lane change is possible (check if another vehicle occupies that spot).
-    for (map<int, vector<Vehicle>>::iterator it = predictions.begin(); it != predictions.end(); ++it)
+    if (this->collision_checker)
     {
 
-        next_lane_vehicle = it->second[0];
+        // ego speeds are in mph (see ref_vel in main.cpp)
+        Vehicle::collider collision
+        = collision_checker->check_lane_change(this->s, this->v / 2.24,
+                                               2 + 4 * this->lane, 2 + 4 * new_lane,
+                                               this->lane_change_time);
 
-        if (next_lane_vehicle.s == this->s && next_lane_vehicle.lane == new_lane)
-        {
-            //If lane change is not possible, return empty trajectory.
-            return trajectory;
+        //If lane change is not possible, return empty trajectory.
+        if (collision.collision) return trajectory;
+    }
+    else
+    {
 
-        }
+      for (map<int, vector<Vehicle>>::const_iterator it = predictions.begin(); it != predictions.end(); ++it)
+      {
+
+          const Vehicle & next_lane_vehicle = it->second[0];
+
+          if (next_lane_vehicle.s == this->s && next_lane_vehicle.lane == new_lane)
+          {
+              //If lane change is not possible, return empty trajectory.
+              return trajectory;
+
+          }
+      }
     }
 
     trajectory.push_back( Vehicle(this->lane, this->s, this->v, this->a, this->state));
 
-    vector<float> kinematics = get_kinematics(predictions, new_lane);
+    array<float, 3> kinematics = get_kinematics(predictions, new_lane);
 
     trajectory.push_back( Vehicle (new_lane, kinematics[0], kinematics[1], kinematics[2], state));
     /*
@@ -394,21 +413,30 @@ vector<Vehicle> Vehicle::lane_change_trajectory(string state, map<int, vector<Ve
    false otherwise. The passed reference
    rVehicle is updated if a vehicle is found.
 */
-bool Vehicle::get_vehicle_behind(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle)
+bool Vehicle::get_vehicle_behind(const map<int, vector<Vehicle>> & predictions, int lane, Vehicle & rVehicle)
 {
 
+    if (lane_features) {
+
+        const LaneFeature & feature = lane_features->lane(lane);
+
+        if (feature.follower_id < 0) return false;
+
+        rVehicle = feature.follower;
+        return true;
+    }
+
     int  max_s = -1;
     bool found_vehicle = false;
-    Vehicle temp_vehicle;
 
-    for (map<int, vector<Vehicle>>::iterator it  = predictions.begin(); it != predictions.end(); ++it)
+    for (map<int, vector<Vehicle>>::const_iterator it  = predictions.begin(); it != predictions.end(); ++it)
     {
 
         if (it->first == -1) continue; // skip for ego car "road.h"
 
-        temp_vehicle = it->second[0];
+        const Vehicle & temp_vehicle = it->second[0];
 
-        if (temp_vehicle.lane == this->lane && temp_vehicle.s < this->s && temp_vehicle.s > max_s)
+        if (temp_vehicle.lane == lane && temp_vehicle.s < this->s && temp_vehicle.s > max_s)
         {
             max_s         = temp_vehicle.s;
             rVehicle      = temp_vehicle;
@@ -425,21 +453,29 @@ bool Vehicle::get_vehicle_behind(map<int, vector<Vehicle>> predictions, int lane
    false otherwise. The passed reference
    rVehicle is updated if a vehicle is found.
 */
-bool Vehicle::get_vehicle_ahead(map<int, vector<Vehicle>> predictions, int lane, Vehicle & rVehicle)
+bool Vehicle::get_vehicle_ahead(const map<int, vector<Vehicle>> & predictions, int lane, Vehicle & rVehicle)
 {
 
+    if (lane_features) {
+
+        const LaneFeature & feature = lane_features->lane(lane);
+
+        if (feature.leader_id < 0) return false;
+
+        rVehicle = feature.leader;
+        return true;
+    }
+
     int min_s          = this->goal_s;
     bool found_vehicle = false;
 
-    Vehicle temp_vehicle;
-
-    for (map<int, vector<Vehicle>>::iterator it  = predictions.begin(); it != predictions.end(); ++it)
+    for (map<int, vector<Vehicle>>::const_iterator it  = predictions.begin(); it != predictions.end(); ++it)
     {
         if (it->first == -1) continue; // skip for ego car "road.h"
 
-        temp_vehicle = it->second[0];
+        const Vehicle & temp_vehicle = it->second[0];
 
-        if (temp_vehicle.lane == this->lane && temp_vehicle.s > this->s && temp_vehicle.s < min_s)
+        if (temp_vehicle.lane == lane && temp_vehicle.s > this->s && temp_vehicle.s < min_s)
         {
           /*
           std::cout << "  [vehicle_ahead] s:"
@@ -476,6 +512,21 @@ vector<Vehicle> Vehicle::generate_predictions(int horizon)
 {
 
 	vector<Vehicle> predictions;
+
+  generate_predictions(predictions, horizon);
+
+  return predictions;
+
+}
+
+/*
+   Same as above, reusing the storage of predictions.
+*/
+void Vehicle::generate_predictions(vector<Vehicle> & predictions, int horizon)
+{
+
+  predictions.clear();
+
   for(int i = 0; i < horizon; i++) {
 
     float next_s = position_at(i);
@@ -483,24 +534,22 @@ vector<Vehicle> Vehicle::generate_predictions(int horizon)
 
     if (i < horizon-1) {
 
-        next_v = position_at(i+1) - s;
+        next_v = position_at(i+1) - next_s;
     }
 
     predictions.push_back(Vehicle(this->lane, next_s, next_v, 0));
   }
 
-  return predictions;
-
 }
 
 /*
    Sets state and kinematics for ego vehicle
    using the last state of the trajectory.
 */
-void Vehicle::realize_next_state(vector<Vehicle> trajectory)
+void Vehicle::realize_next_state(const Trajectory & trajectory)
 {
 
-    Vehicle next_state = trajectory[1];
+    const Vehicle & next_state = trajectory[1];
 
     this->state = next_state.state;
     this->lane  = next_state.lane;